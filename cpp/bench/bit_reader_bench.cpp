@@ -0,0 +1,161 @@
+// Compares the word-at-a-time BitReader against the original bit-by-bit extraction loop on
+// synthetic section-4 payloads shaped like the radar products we ingest.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "radar/bit_reader.h"
+
+using namespace radar;
+
+namespace {
+
+// The pre-optimisation reader: one bounds check and one shift per bit.
+struct LegacyBitReader {
+    const std::vector<std::uint8_t>& buffer;
+    std::size_t bit_pos = 0;
+
+    std::uint32_t read_bits(std::size_t bit_count) {
+        std::uint32_t value = 0;
+        for (std::size_t i = 0; i < bit_count; ++i) {
+            if (bit_pos >= buffer.size() * 8) {
+                throw std::runtime_error("Attempt to read past end of BUFR bitstream");
+            }
+            std::size_t byte_index = bit_pos / 8;
+            std::size_t bit_index = 7 - (bit_pos % 8);
+            std::uint8_t bit = (buffer[byte_index] >> bit_index) & 1;
+            value = (value << 1) | bit;
+            ++bit_pos;
+        }
+        return value;
+    }
+};
+
+struct Payload {
+    std::string name;
+    std::vector<std::size_t> widths;  // field widths of one record, repeated
+    std::size_t records = 0;
+    std::vector<std::uint8_t> bytes;
+};
+
+Payload make_payload(std::string name, std::vector<std::size_t> widths, std::size_t records, std::mt19937& rng) {
+    Payload payload{std::move(name), std::move(widths), records, {}};
+    std::size_t record_bits = 0;
+    for (auto w : payload.widths) {
+        record_bits += w;
+    }
+    payload.bytes.resize((record_bits * records + 7) / 8);
+    for (auto& byte : payload.bytes) {
+        byte = static_cast<std::uint8_t>(rng());
+    }
+    return payload;
+}
+
+template <typename Fn>
+double time_ns(std::size_t repeats, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < repeats; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(repeats);
+}
+
+bool uniform(const Payload& payload) {
+    for (auto w : payload.widths) {
+        if (w != payload.widths.front()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::size_t records = argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : 200000;
+    std::size_t repeats = argc > 2 ? static_cast<std::size_t>(std::strtoull(argv[2], nullptr, 10)) : 5;
+
+    std::mt19937 rng(42);
+    std::vector<Payload> payloads;
+    // One uncompressed gate record per descriptor_tables.json:
+    // AZIMUTH, ELEVATION, RANGE, ROW, COLUMN, DBZH, VRAD, SWRAD, PHENOMENON.
+    payloads.push_back(make_payload("gate record (16/10/16x6/8)", {16, 10, 16, 16, 16, 16, 16, 16, 8}, records, rng));
+    // A run of 16-bit DBZH values, as in a replicated gate sequence.
+    payloads.push_back(make_payload("DBZH run (16 bit)", {16}, records * 9, rng));
+    // Compressed-data increments of an odd width.
+    payloads.push_back(make_payload("increments (7 bit)", {7}, records * 9, rng));
+
+    std::cout << std::left << std::setw(30) << "payload" << std::right << std::setw(14) << "legacy ns/f"
+              << std::setw(14) << "word ns/f" << std::setw(14) << "bulk ns/f" << std::setw(10) << "speedup" << '\n';
+
+    int status = 0;
+    for (const auto& payload : payloads) {
+        const std::size_t fields = payload.widths.size() * payload.records;
+        std::uint64_t legacy_sum = 0;
+        std::uint64_t word_sum = 0;
+        std::uint64_t bulk_sum = 0;
+
+        double legacy_ns = time_ns(repeats, [&] {
+            LegacyBitReader reader{payload.bytes};
+            std::uint64_t sum = 0;
+            for (std::size_t r = 0; r < payload.records; ++r) {
+                for (auto w : payload.widths) {
+                    sum += reader.read_bits(w);
+                }
+            }
+            legacy_sum = sum;
+        });
+
+        double word_ns = time_ns(repeats, [&] {
+            BitReader reader(payload.bytes);
+            std::uint64_t sum = 0;
+            for (std::size_t r = 0; r < payload.records; ++r) {
+                for (auto w : payload.widths) {
+                    sum += reader.read_bits(w);
+                }
+            }
+            word_sum = sum;
+        });
+
+        double bulk_ns = 0.0;
+        if (uniform(payload)) {
+            std::vector<std::uint32_t> out(fields);
+            bulk_ns = time_ns(repeats, [&] {
+                BitReader reader(payload.bytes);
+                reader.read_many(payload.widths.front(), fields, out.data());
+                std::uint64_t sum = 0;
+                for (auto v : out) {
+                    sum += v;
+                }
+                bulk_sum = sum;
+            });
+        } else {
+            bulk_sum = word_sum;
+        }
+
+        if (legacy_sum != word_sum || legacy_sum != bulk_sum) {
+            std::cerr << "Checksum mismatch for " << payload.name << '\n';
+            status = 1;
+        }
+
+        const double per_field = static_cast<double>(fields);
+        const double best = bulk_ns > 0.0 ? std::min(word_ns, bulk_ns) : word_ns;
+        std::cout << std::left << std::setw(30) << payload.name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(14) << legacy_ns / per_field << std::setw(14) << word_ns / per_field << std::setw(14);
+        if (bulk_ns > 0.0) {
+            std::cout << bulk_ns / per_field;
+        } else {
+            std::cout << "-";
+        }
+        std::cout << std::setw(9) << legacy_ns / best << "x\n";
+    }
+    return status;
+}
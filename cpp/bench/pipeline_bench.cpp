@@ -0,0 +1,279 @@
+// Runs the radar_hazard_app pipeline on the volume named by a pipeline configuration and times
+// each stage separately. Generate a large volume with radar_bufr_generator to get useful numbers.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "radar/bufr_decoder.h"
+#include "radar/cell_assembler.h"
+#include "radar/cell_grid.h"
+#include "radar/cluster_analyzer.h"
+#include "radar/config.h"
+#include "radar/contour_file.h"
+#include "radar/contour_merger.h"
+#include "radar/contour_simplifier.h"
+#include "radar/echo_tops.h"
+#include "radar/geo_utils.h"
+#include "radar/image_renderer.h"
+#include "radar/reflectivity_renderer.h"
+#include "radar/tile_renderer.h"
+
+namespace fs = std::filesystem;
+
+using namespace radar;
+
+namespace {
+
+struct StageTime {
+    std::string name;
+    double ms = 0.0;
+};
+
+double peak_rss_mib() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+        return static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0);  // bytes
+#else
+        return static_cast<double>(usage.ru_maxrss) / 1024.0;  // KiB
+#endif
+    }
+#endif
+    return 0.0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: radar_hazard_bench <config.json>\n";
+        return 1;
+    }
+
+    try {
+        auto config = ConfigLoader::load_pipeline(argv[1]);
+        auto tables = ConfigLoader::load_tables(config.tables_path);
+        std::unordered_map<std::string, std::vector<std::string>> sequences;
+        if (!config.sequence_tables_path.empty()) {
+            sequences = ConfigLoader::load_sequences(config.sequence_tables_path);
+        }
+        BufrDecoder decoder(std::move(tables), std::move(sequences), BufrDecoderOptions{
+            .threads = config.decode_threads,
+            .layout = config.bufr_layout,
+        });
+        GeoCalculator geo(config.radar_latitude, config.radar_longitude, config.radar_altitude_m);
+        EchoTops echo_tops;
+        echo_tops.load(config.echo_tops_matrix);
+
+        std::vector<StageTime> stages;
+        auto timed = [&](const char* name, auto&& fn) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            stages.push_back(StageTime{name, std::chrono::duration<double, std::milli>(elapsed).count()});
+        };
+
+        CellAssembler assembler(decoder, echo_tops, CellAssemblyOptions{
+            .min_reflectivity_dbz = config.reflectivity_thresholds.empty()
+                                        ? -std::numeric_limits<double>::infinity()
+                                        : *std::min_element(config.reflectivity_thresholds.begin(),
+                                                            config.reflectivity_thresholds.end()),
+            .allowed_phenomena = config.allowed_phenomena,
+        });
+
+        // Gates are kept as raw records here so decoding and cell building are timed separately.
+        std::vector<GateRecord> records;
+        std::size_t message_count = 0;
+        timed("decode", [&] {
+            message_count = decoder.decode_file(config.bufr_input, [&](const BufrMessageView& message) {
+                assembler.split(message, [&](const GateRecord& record) { records.push_back(record); });
+            });
+        });
+
+        // The reflectivity image is drawn from every gate, before the filters.
+        const bool keep_volume = !config.reflectivity_image_path.empty();
+        std::vector<CellData> cells;
+        std::vector<CellData> volume_cells;
+        timed("cells", [&] {
+            cells.reserve(records.size());
+            for (const auto& record : records) {
+                CellData cell;
+                if (!assembler.build(record, cell)) {
+                    continue;
+                }
+                if (keep_volume) {
+                    volume_cells.push_back(cell);
+                }
+                if (assembler.accepts(cell)) {
+                    cells.push_back(std::move(cell));
+                }
+            }
+        });
+
+        CellGrid grid(geo, config.grid_cell_size_km);
+        timed("grid build", [&] {
+            grid.reserve(cells.size());
+            for (const auto& cell : cells) {
+                grid.add_cell(cell);
+            }
+        });
+
+        ClusterTree tree;
+        timed("clustering", [&] {
+            ClusterAnalyzer analyzer(grid, ClusterOptions{.threads = config.cluster_threads});
+            tree = analyzer.build_cluster_tree(config.reflectivity_thresholds.empty() ? std::vector<double>{35.0}
+                                                                                      : config.reflectivity_thresholds);
+        });
+        std::size_t cluster_count = 0;
+        for (const auto& level : tree) {
+            cluster_count += level.clusters.size();
+        }
+
+        ContourMerger merger(ContourMergeOptions{.mode = config.contour_mode});
+        std::vector<MergedContour> merged;
+        timed("merge", [&] {
+            for (const auto& level : tree) {
+                for (auto& contour : merger.merge(grid, level)) {
+                    contour.threshold_dbz = level.threshold_dbz;
+                    merged.push_back(std::move(contour));
+                }
+            }
+        });
+
+        SimplifyStats simplified;
+        if (config.simplify_tolerance_km > 0.0) {
+            timed("simplify", [&] {
+                ContourSimplifier simplifier(SimplifyOptions{.tolerance_km = config.simplify_tolerance_km});
+                simplified = simplifier.simplify(merged);
+            });
+        }
+
+        if (config.contour_output_format != ContourOutputFormat::Binary) {
+            timed("geojson", [&] {
+                if (!fs::path(config.merged_geojson_output).parent_path().empty()) {
+                    fs::create_directories(fs::path(config.merged_geojson_output).parent_path());
+                }
+                merger.write_geojson(merged, config.merged_geojson_output, GeoJsonOptions{
+                    .coordinate_precision = config.geojson_precision,
+                    .compact = config.geojson_compact,
+                });
+            });
+        }
+        if (config.contour_output_format != ContourOutputFormat::GeoJson) {
+            timed("binary", [&] {
+                if (!fs::path(config.merged_binary_output).parent_path().empty()) {
+                    fs::create_directories(fs::path(config.merged_binary_output).parent_path());
+                }
+                ContourFileWriter::write(merged, config.merged_binary_output);
+            });
+        }
+
+        if (!config.image_output_path.empty()) {
+            timed("image", [&] {
+                if (!fs::path(config.image_output_path).parent_path().empty()) {
+                    fs::create_directories(fs::path(config.image_output_path).parent_path());
+                }
+                ImageRenderer renderer(ImageRenderOptions{
+                    .width = config.image_width,
+                    .height = config.image_height,
+                    .threads = config.render_threads,
+                    .format = config.image_format,
+                    .palette = config.image_palette,
+                });
+                renderer.render(merged, config.image_output_path);
+            });
+        }
+
+        if (!config.reflectivity_image_path.empty()) {
+            if (!fs::path(config.reflectivity_image_path).parent_path().empty()) {
+                fs::create_directories(fs::path(config.reflectivity_image_path).parent_path());
+            }
+            CellGrid volume(geo, config.grid_cell_size_km);
+            timed("ppi volume", [&] {
+                volume.reserve(volume_cells.size());
+                for (const auto& cell : volume_cells) {
+                    volume.add_cell(cell);
+                }
+            });
+            std::optional<ReflectivityRenderer> reflectivity;
+            timed("ppi mapping", [&] {
+                reflectivity.emplace(volume, ReflectivityRenderOptions{
+                    .width = config.image_width,
+                    .height = config.image_height,
+                    .radar_latitude_deg = config.radar_latitude,
+                    .radar_longitude_deg = config.radar_longitude,
+                    .max_range_km = config.reflectivity_max_range_km,
+                    .threads = config.render_threads,
+                    .format = config.image_format,
+                    .palette = config.image_palette,
+                });
+            });
+            std::vector<unsigned char> pixels;
+            timed("ppi colour", [&] { pixels = reflectivity->render(volume); });
+            timed("ppi write", [&] {
+                ImageRenderer::write_image(pixels, ImageRenderOptions{
+                    .width = config.image_width,
+                    .height = config.image_height,
+                    .threads = config.render_threads,
+                    .format = config.image_format,
+                    .palette = config.image_palette,
+                }, config.reflectivity_image_path);
+            });
+        }
+
+        TileStats tiles;
+        if (!config.tile_output_dir.empty()) {
+            timed("tiles", [&] {
+                TileRenderer tiler(config.tile_output_dir, TileOptions{
+                    .min_zoom = config.tile_min_zoom,
+                    .max_zoom = config.tile_max_zoom,
+                    .threads = config.render_threads,
+                    .palette = config.image_palette,
+                });
+                tiles = tiler.render(merged);
+            });
+        }
+
+        const double gates = static_cast<double>(records.size());
+        double total_ms = 0.0;
+        std::cout << std::left << std::setw(14) << "stage" << std::right << std::setw(12) << "ms" << std::setw(16)
+                  << "gates/s" << '\n';
+        for (const auto& stage : stages) {
+            total_ms += stage.ms;
+            std::cout << std::left << std::setw(14) << stage.name << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(12) << stage.ms << std::setw(16) << std::setprecision(0)
+                      << gates / (stage.ms / 1000.0) << '\n';
+        }
+        std::cout << std::left << std::setw(14) << "total" << std::right << std::setprecision(2) << std::setw(12)
+                  << total_ms << std::setw(16) << std::setprecision(0) << gates / (total_ms / 1000.0) << '\n';
+        std::cout << "messages " << message_count << ", gates " << records.size() << ", cells " << grid.size()
+                  << ", clusters " << cluster_count << ", contours " << merged.size() << '\n';
+        if (config.simplify_tolerance_km > 0.0) {
+            std::cout << "simplify removed " << simplified.removed() << " of " << simplified.vertices_before
+                      << " vertices\n";
+        }
+        if (!config.tile_output_dir.empty()) {
+            std::cout << "tiles " << tiles.tiles << ", written " << tiles.written << ", unchanged " << tiles.unchanged
+                      << ", removed " << tiles.removed << '\n';
+        }
+        std::cout << "peak RSS " << std::setprecision(1) << peak_rss_mib() << " MiB" << std::endl;
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
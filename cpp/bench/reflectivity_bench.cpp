@@ -0,0 +1,125 @@
+// Times the reflectivity colour kernel on a synthetic plan position indicator: every pixel of a
+// square map looks up its gate through a polar pixel -> gate table and is coloured from the
+// dBZ value. Compares a per-pixel search over the colour steps, a scalar table lookup and
+// colour_gates() (AVX2 when built with RADAR_ENABLE_AVX2).
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "radar/reflectivity_renderer.h"
+
+using namespace radar;
+
+namespace {
+
+template <typename Fn>
+double time_ms(std::size_t repeats, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < repeats; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count() / static_cast<double>(repeats);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t size = argc > 1 ? static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10)) : 2048;
+    const std::size_t repeats = argc > 2 ? static_cast<std::size_t>(std::strtoull(argv[2], nullptr, 10)) : 20;
+    constexpr std::size_t kAzimuths = 360;
+    constexpr std::size_t kGates = 500;
+
+    // Noise floor with a few storms, and some missing gates.
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 4.0f);
+    std::vector<float> dbz(kAzimuths * kGates);
+    for (std::size_t a = 0; a < kAzimuths; ++a) {
+        for (std::size_t g = 0; g < kGates; ++g) {
+            float value = noise(rng);
+            for (std::size_t storm = 0; storm < 4; ++storm) {
+                const double da = static_cast<double>(a) - 40.0 - 85.0 * static_cast<double>(storm);
+                const double dg = static_cast<double>(g) - 120.0 - 90.0 * static_cast<double>(storm);
+                value += static_cast<float>(60.0 * std::exp(-(da * da / 60.0 + dg * dg / 900.0)));
+            }
+            dbz[a * kGates + g] = rng() % 50 == 0 ? std::nanf("") : value;
+        }
+    }
+
+    std::vector<std::uint32_t> gate_of_pixel(size * size, kNoGate);
+    const double centre = static_cast<double>(size) / 2.0;
+    for (std::size_t y = 0; y < size; ++y) {
+        for (std::size_t x = 0; x < size; ++x) {
+            const double east = static_cast<double>(x) + 0.5 - centre;
+            const double north = centre - (static_cast<double>(y) + 0.5);
+            const double range = std::hypot(east, north) / centre * kGates;
+            if (range < kGates) {
+                double azimuth = std::atan2(east, north) * 180.0 / 3.14159265358979323846;
+                azimuth = azimuth < 0.0 ? azimuth + 360.0 : azimuth;
+                gate_of_pixel[y * size + x] = static_cast<std::uint32_t>(
+                    (static_cast<std::size_t>(azimuth) % kAzimuths) * kGates + static_cast<std::size_t>(range));
+            }
+        }
+    }
+
+    const auto lut = ReflectivityLut::standard();
+    // Colour steps as a renderer without a table would search them.
+    struct Step {
+        float dbz;
+        std::uint32_t bgrx;
+    };
+    std::vector<Step> steps;
+    for (std::size_t i = 1; i < lut.bgrx.size(); ++i) {
+        if (lut.bgrx[i] != lut.bgrx[i - 1]) {
+            steps.push_back({lut.min_dbz + static_cast<float>(i - 1) * lut.step_dbz, lut.bgrx[i]});
+        }
+    }
+
+    std::vector<unsigned char> searched(size * size * 3);
+    std::vector<unsigned char> scalar(size * size * 3);
+    std::vector<unsigned char> kernel(size * size * 3);
+    const double search_ms = time_ms(repeats, [&] {
+        for (std::size_t p = 0; p < gate_of_pixel.size(); ++p) {
+            std::uint32_t colour = lut.bgrx[0];
+            if (gate_of_pixel[p] != kNoGate) {
+                const float value = dbz[gate_of_pixel[p]];
+                for (const auto& step : steps) {
+                    if (value >= step.dbz) {
+                        colour = step.bgrx;
+                    }
+                }
+            }
+            std::memcpy(&searched[3 * p], &colour, 3);
+        }
+    });
+    const double scalar_ms = time_ms(repeats, [&] {
+        for (std::size_t p = 0; p < gate_of_pixel.size(); ++p) {
+            const std::uint8_t index = gate_of_pixel[p] == kNoGate ? 0 : lut.index(dbz[gate_of_pixel[p]]);
+            std::memcpy(&scalar[3 * p], &lut.bgrx[index], 3);
+        }
+    });
+    const double kernel_ms = time_ms(repeats, [&] { colour_gates(gate_of_pixel, dbz, lut, kernel.data()); });
+
+    if (scalar != kernel) {
+        std::cerr << "Kernel output differs from the scalar lookup\n";
+        return 1;
+    }
+    const double megapixels = static_cast<double>(size * size) / 1e6;
+    std::cout << size << 'x' << size << " PPI, " << kAzimuths << 'x' << kGates << " gates\n";
+    std::cout << std::left << std::setw(16) << "method" << std::right << std::setw(12) << "ms/frame" << std::setw(12)
+              << "Mpixel/s" << std::setw(10) << "fps" << '\n';
+    for (const auto& [name, ms] : {std::pair{"step search", search_ms}, std::pair{"scalar lut", scalar_ms},
+                                   std::pair{"colour_gates", kernel_ms}}) {
+        std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << ms << std::setw(12) << megapixels / (ms / 1000.0) << std::setw(10)
+                  << std::setprecision(1) << 1000.0 / ms << '\n';
+    }
+    return 0;
+}
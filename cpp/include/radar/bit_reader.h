@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace radar {
+
+// MSB-first reader over a BUFR data section. Fields of up to 32 bits are extracted from a
+// single big-endian 64-bit load with one shift pair instead of bit-by-bit.
+class BitReader {
+public:
+    static constexpr std::size_t kMaxFieldBits = 32;
+
+    explicit BitReader(std::span<const std::uint8_t> data) : buffer_(data) {}
+
+    std::uint32_t read_bits(std::size_t bit_count) {
+        require(bit_count);
+        if (bit_count == 0) {
+            return 0;
+        }
+        std::uint64_t word = load_word(bit_pos_ / 8) << (bit_pos_ % 8);
+        bit_pos_ += bit_count;
+        return static_cast<std::uint32_t>(word >> (64 - bit_count));
+    }
+
+    // Reads `count` consecutive fields of identical width into `out`.
+    void read_many(std::size_t bit_count, std::size_t count, std::uint32_t* out);
+    void skip_bits(std::size_t bit_count);
+
+    std::size_t bit_position() const { return bit_pos_; }
+    std::size_t remaining_bits() const { return buffer_.size() * 8 - bit_pos_; }
+    void reset() { bit_pos_ = 0; }
+
+private:
+    void require(std::size_t bit_count) const {
+        if (bit_count > kMaxFieldBits || bit_count > remaining_bits()) {
+            fail(bit_count);
+        }
+    }
+
+    // Big-endian load of the 8 bytes starting at `byte_index`, zero-padded past the end.
+    // Compilers lower the shift-or chain to a single load plus byte swap.
+    std::uint64_t load_word(std::size_t byte_index) const {
+        if (byte_index + 8 > buffer_.size()) {
+            return load_tail(byte_index);
+        }
+        const std::uint8_t* p = buffer_.data() + byte_index;
+        return (std::uint64_t{p[0]} << 56) | (std::uint64_t{p[1]} << 48) | (std::uint64_t{p[2]} << 40) |
+               (std::uint64_t{p[3]} << 32) | (std::uint64_t{p[4]} << 24) | (std::uint64_t{p[5]} << 16) |
+               (std::uint64_t{p[6]} << 8) | std::uint64_t{p[7]};
+    }
+
+    std::uint64_t load_tail(std::size_t byte_index) const;
+    [[noreturn]] void fail(std::size_t bit_count) const;
+    [[noreturn]] static void fail_end_of_stream();
+
+    std::span<const std::uint8_t> buffer_;
+    std::size_t bit_pos_ = 0;
+};
+
+}  // namespace radar
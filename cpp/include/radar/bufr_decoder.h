@@ -2,11 +2,15 @@
 
 #include <cstdint>
 #include <filesystem>
-#include <optional>
+#include <functional>
+#include <memory>
+#include <span>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "radar/bit_reader.h"
 #include "radar/config.h"
 
 namespace radar {
@@ -15,17 +19,71 @@ struct BufrValue {
     std::string mnemonic;
     double value = 0.0;
     std::string unit;
+    std::uint32_t item = 0;  // see DecodedValue::item
 };
 
 struct BufrMessage {
     std::vector<BufrValue> values;
+    std::vector<std::uint32_t> item_parents;  // see BufrMessageView::item_parents
+};
+
+// A decoded element identified by its index in the decoder's descriptor table.
+struct DecodedValue {
+    std::uint32_t descriptor_id = 0;
+    // Repetition of a replicated body the value was decoded in. Every repetition of every
+    // replication in the subset gets the next number in decode order; 0 is outside any
+    // replication. Missing values are still dropped, so this is what tells where one replicated
+    // item (a gate, say) ends and the next begins.
+    std::uint32_t item = 0;
+    double value = 0.0;
+};
+
+// One decoded subset as seen by a streaming sink. Multi-subset messages produce one view per
+// subset. `values` and `item_parents` point into decoder-owned scratch space and are only valid
+// for the duration of the callback.
+struct BufrMessageView {
+    std::size_t index = 0;
+    std::size_t subset = 0;
+    std::span<const DecodedValue> values;
+    // Enclosing item of each item, indexed by item: 0 for the repetitions of a top-level
+    // replication, the outer repetition for nested ones. Entry 0 is item 0 itself.
+    std::span<const std::uint32_t> item_parents;
+};
+
+using BufrMessageSink = std::function<void(const BufrMessageView&)>;
+
+struct BufrDecoderOptions {
+    // Worker threads for decoding independent messages; 0 uses every hardware thread.
+    std::size_t threads = 1;
+    BufrLayout layout = BufrLayout::Compact;
 };
 
 class BufrDecoder {
 public:
-    explicit BufrDecoder(std::unordered_map<std::string, DescriptorDefinition> tables);
+    explicit BufrDecoder(std::unordered_map<std::string, DescriptorDefinition> tables,
+                         BufrDecoderOptions options = {});
+    // `sequences` is Table D: each "3-XXX-YYY" key lists the descriptors it expands to.
+    BufrDecoder(std::unordered_map<std::string, DescriptorDefinition> tables,
+                std::unordered_map<std::string, std::vector<std::string>> sequences, BufrDecoderOptions options = {});
+    ~BufrDecoder();
+    BufrDecoder(BufrDecoder&&) noexcept;
+    BufrDecoder& operator=(BufrDecoder&&) noexcept;
 
+    // Materialises every subset of every message, in file order, as its own BufrMessage.
     std::vector<BufrMessage> decode_file(const std::filesystem::path& path) const;
+    std::vector<BufrMessage> decode_buffer(std::span<const std::uint8_t> data) const;
+
+    // Streams every subset of every message in `data` to `sink` in file order and returns the
+    // message count.
+    // Message boundaries are found first from the section-0 lengths. With one thread a single
+    // message is held at a time; with more, messages are decoded in parallel in bounded windows
+    // of (threads x 256) and handed to the sink from the calling thread.
+    std::size_t decode_file(const std::filesystem::path& path, const BufrMessageSink& sink) const;
+    std::size_t decode_buffer(std::span<const std::uint8_t> data, const BufrMessageSink& sink) const;
+    std::vector<std::span<const std::uint8_t>> scan_messages(std::span<const std::uint8_t> data) const;
+
+    const DescriptorDefinition& definition(std::uint32_t descriptor_id) const { return definitions_[descriptor_id]; }
+    std::size_t descriptor_count() const { return definitions_.size(); }
 
 private:
     struct Descriptor {
@@ -34,21 +92,75 @@ private:
         int y = 0;
     };
 
-    struct BitReader {
-        std::vector<std::uint8_t> buffer;
-        mutable std::size_t bit_pos = 0;
+    // One element of a compiled section 3: everything needed to turn raw bits into a value.
+    struct DecodeStep {
+        std::uint32_t descriptor_id = 0;
+        std::uint32_t bits = 0;
+        std::uint32_t missing = 0;  // all-ones pattern for `bits`
+        double reference = 0.0;
+        // 10^scale. Dividing (rather than multiplying by 10^-scale) keeps values bit-identical,
+        // since negative powers of ten are not exactly representable.
+        double scale_divisor = 1.0;
+        // Non-zero for a replication: the next `replicated` steps repeat as many times as the
+        // decoded factor says, or `repeats` times for a fixed replication, which reads no bits.
+        std::uint32_t replicated = 0;
+        std::uint32_t repeats = 0;
+    };
+
+    // Section 3 with sequences expanded. Replications stay as a step in front of their body, so
+    // every repetition can be told apart in the output.
+    struct DecodePlan {
+        std::vector<std::uint8_t> signature;  // section-3 descriptor bytes the plan was built from
+        std::vector<DecodeStep> steps;
+        bool has_replication = false;
+    };
 
-        explicit BitReader(std::vector<std::uint8_t> data) : buffer(std::move(data)) {}
+    // Output of one message: values of all subsets back to back, split by `subset_offsets`
+    // (subsets + 1 entries). `item_ranges` picks each subset's item parents out of
+    // `item_parents`; compressed subsets share one replication structure and one range.
+    struct DecodedMessage {
+        std::vector<DecodedValue> values;
+        std::vector<std::size_t> subset_offsets;
+        std::vector<std::uint32_t> item_parents;
+        std::vector<std::pair<std::size_t, std::size_t>> item_ranges;
+    };
 
-        std::uint32_t read_bits(std::size_t bit_count) const;
-        void reset() const { bit_pos = 0; }
+    // Per-worker buffers for compressed data, reused from message to message.
+    struct DecodeScratch {
+        const DecodePlan* plan = nullptr;  // last plan used, checked before the cache
+        std::vector<std::uint32_t> increments;
+        std::vector<double> columns;              // one column of `subsets` values per executed step
+        std::vector<std::uint32_t> column_ids;    // descriptor id of each column
+        std::vector<std::uint32_t> column_items;  // replicated item of each column
     };
 
-    DescriptorDefinition resolve(const Descriptor& descriptor) const;
-    std::vector<Descriptor> parse_section3(const std::vector<std::uint8_t>& section) const;
-    std::vector<BufrValue> decode_data(const BitReader& reader, const std::vector<Descriptor>& descriptors) const;
+    struct PlanCache;
+
+    static std::uint16_t pack(const Descriptor& descriptor) {
+        return static_cast<std::uint16_t>((descriptor.f << 14) | (descriptor.x << 8) | descriptor.y);
+    }
+
+    static bool parse_key(const std::string& key, Descriptor& descriptor);
+    std::uint32_t resolve(const Descriptor& descriptor) const;
+    std::vector<Descriptor> parse_section3(std::span<const std::uint8_t> descriptors) const;
+    const DecodePlan& plan_for(std::span<const std::uint8_t> descriptors) const;
+    std::shared_ptr<const DecodePlan> compile_plan(std::span<const std::uint8_t> descriptors) const;
+    void expand(std::span<const Descriptor> descriptors, DecodePlan& plan, std::size_t depth) const;
+    DecodeStep element_step(const Descriptor& descriptor) const;
+    void decode_message(std::span<const std::uint8_t> message, DecodeScratch& scratch, DecodedMessage& out) const;
+    void decode_data(BitReader& reader, const DecodePlan& plan, DecodedMessage& out) const;
+    void decode_steps(BitReader& reader, std::span<const DecodeStep> steps, std::uint32_t item,
+                      std::size_t items_begin, DecodedMessage& out) const;
+    void unpack_columns(BitReader& reader, std::span<const DecodeStep> steps, std::size_t subsets,
+                        std::uint32_t item, DecodeScratch& scratch, std::vector<std::uint32_t>& item_parents) const;
+    void decode_compressed(BitReader& reader, const DecodePlan& plan, std::size_t subsets, DecodeScratch& scratch,
+                           DecodedMessage& out) const;
 
-    std::unordered_map<std::string, DescriptorDefinition> tables_;
+    std::vector<DescriptorDefinition> definitions_;
+    std::unordered_map<std::uint16_t, std::uint32_t> ids_by_code_;
+    std::unordered_map<std::uint16_t, std::vector<Descriptor>> sequences_;
+    std::unique_ptr<PlanCache> plans_;
+    BufrDecoderOptions options_;
 };
 
 }  // namespace radar
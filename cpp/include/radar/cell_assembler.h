@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "radar/bufr_decoder.h"
+#include "radar/cell_grid.h"
+#include "radar/echo_tops.h"
+#include "radar/geo_utils.h"
+
+namespace radar {
+
+// Gate-level quantities the pipeline reads from decoded messages.
+enum class GateField : std::uint8_t {
+    Row,
+    Column,
+    Reflectivity,
+    Velocity,
+    SpectrumWidth,
+    Azimuth,
+    Range,
+    Elevation,
+    Phenomenon,
+    Count,
+};
+
+// Raw decoded values of one gate, indexed by GateField.
+struct GateRecord {
+    static constexpr std::size_t kFieldCount = static_cast<std::size_t>(GateField::Count);
+
+    std::array<double, kFieldCount> values{};
+    std::uint32_t present = 0;  // bit per GateField
+
+    bool has(GateField field) const { return (present >> static_cast<unsigned>(field)) & 1u; }
+    double get(GateField field, double fallback = 0.0) const {
+        return has(field) ? values[static_cast<std::size_t>(field)] : fallback;
+    }
+};
+
+struct CellAssemblyOptions {
+    double min_reflectivity_dbz = -std::numeric_limits<double>::infinity();
+    std::vector<std::string> allowed_phenomena;  // empty accepts every phenomenon
+};
+
+// Builds CellData from decoded subsets. Mnemonics are resolved against the decoder's descriptor
+// table once at construction, so each value is routed to its GateField by descriptor id without
+// hashing or allocating. split() keeps its replication stack in the assembler and reuses it, so
+// one assembler must not split messages from several threads at once.
+class CellAssembler {
+public:
+    CellAssembler(const BufrDecoder& decoder, const EchoTops& echo_tops, CellAssemblyOptions options = {});
+
+    // Calls emit(const GateRecord&) for every gate in `message`. Without replication the subset
+    // is one gate. Otherwise every repetition of an innermost replicated body is a gate: it
+    // starts from the fields of the repetitions enclosing it (ray-level azimuth, elevation, ...)
+    // and adds its own, so a value missing from one gate is absent rather than carried over from
+    // the previous gate.
+    template <typename Emit>
+    void split(const BufrMessageView& message, Emit&& emit) const {
+        if (message.item_parents.size() <= 1) {
+            GateRecord record;
+            for (const auto& value : message.values) {
+                set(record, value);
+            }
+            emit(static_cast<const GateRecord&>(record));
+            return;
+        }
+
+        auto& open = open_items_;
+        open.assign(1, OpenItem{});
+        auto is_open = [&](std::uint32_t item) {
+            return std::any_of(open.begin(), open.end(), [&](const OpenItem& entry) { return entry.item == item; });
+        };
+        auto close = [&] {
+            if (!open.back().nested) {
+                emit(static_cast<const GateRecord&>(open.back().record));
+            }
+            open.pop_back();
+        };
+        for (const auto& value : message.values) {
+            if (field_by_id_[value.descriptor_id] == kUnmapped) {
+                continue;
+            }
+            if (value.item != open.back().item) {
+                // Close repetitions up to the nearest open ancestor (item 0 always is), then
+                // open this one inside it unless it was open already.
+                std::uint32_t ancestor = value.item;
+                while (!is_open(ancestor)) {
+                    ancestor = message.item_parents[ancestor];
+                }
+                while (open.back().item != ancestor) {
+                    close();
+                }
+                if (ancestor != value.item) {
+                    open.back().nested = true;
+                    open.push_back(OpenItem{value.item, false, open.back().record});
+                }
+            }
+            set(open.back().record, value);
+        }
+        while (!open.empty()) {
+            close();
+        }
+    }
+    // Fills `cell` from `record`; false when the gate lacks a row, column or reflectivity.
+    bool build(const GateRecord& record, CellData& cell) const;
+    // Whether a built cell passes the phenomenon and reflectivity filters.
+    bool accepts(const CellData& cell) const;
+
+    // split() followed by build(); calls emit(CellData&&) for every accepted gate.
+    template <typename Emit>
+    void assemble(const BufrMessageView& message, Emit&& emit) const {
+        split(message, [&](const GateRecord& record) {
+            CellData cell;
+            if (build(record, cell) && accepts(cell)) {
+                emit(std::move(cell));
+            }
+        });
+    }
+
+private:
+    static constexpr std::uint8_t kUnmapped = 0xFF;
+
+    // A repetition split() is inside of, with the fields gathered for it so far.
+    struct OpenItem {
+        std::uint32_t item = 0;
+        bool nested = false;  // holds another repetition, so it is not a gate itself
+        GateRecord record;
+    };
+
+    void set(GateRecord& record, const DecodedValue& value) const {
+        const std::uint8_t field = field_by_id_[value.descriptor_id];
+        if (field != kUnmapped) {
+            record.values[field] = value.value;
+            record.present |= 1u << field;
+        }
+    }
+
+    std::vector<std::uint8_t> field_by_id_;  // GateField per descriptor id, or kUnmapped
+    const EchoTops& echo_tops_;
+    CellAssemblyOptions options_;
+    mutable std::vector<OpenItem> open_items_;  // split() scratch, grown to the deepest nesting seen
+};
+
+}  // namespace radar
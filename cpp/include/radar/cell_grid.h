@@ -1,8 +1,11 @@
 #pragma once
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "radar/geo_utils.h"
@@ -15,20 +18,128 @@ struct CellData {
     double reflectivity_dbz = 0.0;
     double velocity_ms = 0.0;
     double spectrum_width = 0.0;
-    CellGeometry geometry;
+    RadarObservation observation;  // where the gate is; see GeoCalculator::compute_geometry()
     std::optional<double> echo_top_km;
     std::string phenomenon_type;
 };
 
+// Row/column rectangle [min_row, min_row + rows) x [min_column, min_column + columns).
+struct GridExtent {
+    int min_row = 0;
+    int min_column = 0;
+    int rows = 0;
+    int columns = 0;
+
+    bool contains(int row, int column) const {
+        return row >= min_row && column >= min_column && row - min_row < rows && column - min_column < columns;
+    }
+    std::size_t area() const { return static_cast<std::size_t>(rows) * static_cast<std::size_t>(columns); }
+};
+
+// Cells keyed by (row, column), stored column-wise: one contiguous array per field, indexed by
+// cell index. Radar moments are kept as float, a missing echo top is NaN and phenomenon codes
+// are ids into an intern table. Cell geometry is not stored: each cell keeps its azimuth,
+// range and elevation as float and geometry() recomputes the outline from them, which takes
+// 38 bytes a cell instead of the 80 of a stored CellGeometry.
+//
+// Lookups go through a dense raster of cell indices covering the grid extent, so finding a
+// cell or its neighbours is a bounds check and one load. Grids whose extent is far larger than
+// their cell count fall back to a hashed index.
 class CellGrid {
 public:
-    void add_cell(CellData cell);
-    const std::vector<CellData>& cells() const { return cells_; }
-    std::optional<CellData> find(int row, int column) const;
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    // `geo` and `gate_length_km` turn the stored observations into cell geometry.
+    CellGrid(const GeoCalculator& geo, double gate_length_km) : geo_(geo), gate_length_km_(gate_length_km) {}
+
+    // Adds a cell, replacing any earlier cell at the same row and column.
+    void add_cell(const CellData& cell);
+    void reserve(std::size_t count);
+
+    std::size_t size() const { return rows_.size(); }
+    bool empty() const { return rows_.empty(); }
+
+    // Position of the cell at (row, column), or npos.
+    std::size_t index_of(int row, int column) const {
+        if (sparse_) {
+            return sparse_index_of(row, column);
+        }
+        if (!raster_extent_.contains(row, column)) {
+            return npos;
+        }
+        auto index = raster_[raster_slot(row, column)];
+        return index == kEmpty ? npos : index;
+    }
+    // Assembles a CellData from the columns.
+    CellData cell(std::size_t index) const;
+
+    std::span<const int> rows() const { return rows_; }
+    std::span<const int> columns() const { return columns_; }
+    std::span<const float> reflectivity_dbz() const { return reflectivity_dbz_; }
+    std::span<const float> velocity_ms() const { return velocity_ms_; }
+    std::span<const float> spectrum_width() const { return spectrum_width_; }
+    std::span<const float> echo_top_km() const { return echo_top_km_; }  // NaN when absent
+    std::span<const std::uint16_t> phenomenon_ids() const { return phenomenon_ids_; }
+    std::span<const float> azimuth_deg() const { return azimuth_deg_; }
+    std::span<const float> range_km() const { return range_km_; }
+    std::span<const float> elevation_deg() const { return elevation_deg_; }
+
+    RadarObservation observation(std::size_t index) const {
+        return RadarObservation{azimuth_deg_[index], range_km_[index], elevation_deg_[index]};
+    }
+    // Computed on every call.
+    CellGeometry geometry(std::size_t index) const {
+        return geo_.compute_geometry(observation(index), gate_length_km_);
+    }
+    GeoCoordinate center(std::size_t index) const { return geo_.compute_center(observation(index)); }
+
+    // Intern table behind phenomenon_ids().
+    const std::vector<std::string>& phenomena() const { return phenomena_; }
+    const std::string& phenomenon(std::size_t index) const { return phenomena_[phenomenon_ids_[index]]; }
+
+    // Smallest rectangle holding every cell.
+    const GridExtent& extent() const { return extent_; }
+    bool is_dense() const { return !sparse_; }
 
 private:
-    std::vector<CellData> cells_;
-    std::map<std::pair<int, int>, std::size_t> index_;
+    static constexpr std::uint32_t kEmpty = UINT32_MAX;
+
+    std::size_t raster_slot(int row, int column) const {
+        return static_cast<std::size_t>(row - raster_extent_.min_row) * static_cast<std::size_t>(raster_extent_.columns) +
+               static_cast<std::size_t>(column - raster_extent_.min_column);
+    }
+    static std::uint64_t sparse_key(int row, int column) {
+        return (std::uint64_t{static_cast<std::uint32_t>(row)} << 32) | static_cast<std::uint32_t>(column);
+    }
+    std::size_t sparse_index_of(int row, int column) const;
+    void rebuild_index();
+    std::uint16_t intern(const std::string& phenomenon);
+    void store(std::size_t index, const CellData& cell);
+
+    std::vector<int> rows_;
+    std::vector<int> columns_;
+    std::vector<float> reflectivity_dbz_;
+    std::vector<float> velocity_ms_;
+    std::vector<float> spectrum_width_;
+    std::vector<float> echo_top_km_;
+    std::vector<std::uint16_t> phenomenon_ids_;
+    std::vector<float> azimuth_deg_;
+    std::vector<float> range_km_;
+    std::vector<float> elevation_deg_;
+
+    GeoCalculator geo_;
+    double gate_length_km_ = 1.0;
+
+    std::vector<std::string> phenomena_;
+    std::unordered_map<std::string, std::uint16_t> phenomenon_lookup_;
+    std::uint16_t last_phenomenon_ = 0;
+
+    GridExtent extent_;
+    GridExtent raster_extent_;  // extent_ plus growth slack
+    std::vector<std::uint32_t> raster_;
+    std::unordered_map<std::uint64_t, std::uint32_t> sparse_index_;
+    bool sparse_ = false;
+    std::size_t sparse_checked_at_ = 0;  // cell count when the sparse index was last chosen
 };
 
 }  // namespace radar
@@ -1,30 +1,96 @@
 #pragma once
 
-#include <map>
-#include <set>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
 #include <vector>
 
 #include "radar/cell_grid.h"
 
 namespace radar {
 
+// Aggregates of a cluster, accumulated while its cells are gathered. The cells themselves stay
+// in the grid; the cluster only records where its member indices sit in ClusterSet::members.
 struct Cluster {
-    std::vector<CellData> cells;
+    std::uint32_t seed = 0;          // grid index of the first cell in insertion order
+    std::uint32_t first_member = 0;  // members are ClusterSet::members[first_member, first_member + cell_count)
+    std::uint32_t cell_count = 0;
+    double area_km2 = 0.0;
+    GeoCoordinate centroid;  // area-weighted mean of the cell centres
     double max_reflectivity = 0.0;
+    double mean_reflectivity_dbz = std::numeric_limits<double>::quiet_NaN();
     std::optional<double> max_echo_top_km;
+    double min_velocity_ms = std::numeric_limits<double>::quiet_NaN();
+    double max_velocity_ms = std::numeric_limits<double>::quiet_NaN();
+    GeoBounds bounds;  // over the cell vertices
 };
 
+// Clusters at one threshold with their member cell indices grouped per cluster, each group in
+// grid insertion order.
+struct ClusterSet {
+    double threshold_dbz = 0.0;
+    std::vector<Cluster> clusters;
+    std::vector<std::uint32_t> members;
+
+    std::span<const std::uint32_t> members_of(const Cluster& cluster) const {
+        return std::span<const std::uint32_t>(members).subspan(cluster.first_member, cluster.cell_count);
+    }
+};
+
+// One level of a ClusterTree. Raising the threshold only splits or shrinks clusters, so each
+// cluster lies inside exactly one cluster of the level below.
+struct ClusterLevel : ClusterSet {
+    static constexpr std::uint32_t kNoParent = UINT32_MAX;
+
+    // Enclosing cluster on the level below, kNoParent on the lowest level.
+    std::vector<std::uint32_t> parents;
+    // Clusters of the level above nested in cluster c: child_ids[child_offsets[c], child_offsets[c + 1]).
+    std::vector<std::uint32_t> child_offsets;
+    std::vector<std::uint32_t> child_ids;
+
+    std::span<const std::uint32_t> children(std::size_t cluster) const {
+        return std::span<const std::uint32_t>(child_ids).subspan(child_offsets[cluster],
+                                                                 child_offsets[cluster + 1] - child_offsets[cluster]);
+    }
+};
+
+// Levels ordered by ascending threshold.
+using ClusterTree = std::vector<ClusterLevel>;
+
+struct ClusterOptions {
+    // Worker threads for labelling; 0 uses every hardware thread. The result does not depend
+    // on the thread count.
+    std::size_t threads = 1;
+};
+
+// Groups cells at or above a reflectivity threshold into 8-connected clusters. Clusters are
+// ordered by their seed, the first cell in grid insertion order.
 class ClusterAnalyzer {
 public:
-    explicit ClusterAnalyzer(const CellGrid& grid);
+    explicit ClusterAnalyzer(const CellGrid& grid, ClusterOptions options = {});
+
+    ClusterSet find_clusters(double reflectivity_threshold_dbz) const;
+
+    // Clusters for every threshold from one labelling pass: cells are added from the highest
+    // level down, so each level's components grow out of the ones above. Duplicate thresholds
+    // are dropped; each level matches find_clusters() at its threshold.
+    ClusterTree build_cluster_tree(std::vector<double> thresholds_dbz) const;
 
-    std::vector<Cluster> find_clusters(double reflectivity_threshold_dbz) const;
+    // Cluster number of every cell, in find_clusters() order, or kUnlabelled for cells below
+    // the threshold.
+    static constexpr std::uint32_t kUnlabelled = UINT32_MAX;
+    std::vector<std::uint32_t> label_cells(double reflectivity_threshold_dbz) const;
 
 private:
-    void visit(int row, int column, double threshold, std::set<std::pair<int, int>>& visited, Cluster& cluster) const;
-    std::vector<std::pair<int, int>> neighbors(int row, int column) const;
+    // Both return union-find roots per cell; label_cells() renumbers them. The threshold is
+    // rounded to float like the reflectivity it is compared with.
+    std::vector<std::uint32_t> label_raster(float threshold) const;
+    std::vector<std::uint32_t> label_sparse(float threshold) const;
 
     const CellGrid& grid_;
+    ClusterOptions options_;
 };
 
 }  // namespace radar
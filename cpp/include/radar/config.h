@@ -16,19 +16,69 @@ struct DescriptorDefinition {
     std::string unit;
 };
 
+// How sections 1-4 of a BUFR message are laid out.
+enum class BufrLayout {
+    // Section 2 is always present and section 3 is a flags byte followed by descriptors, one
+    // subset per message.
+    Compact,
+    // WMO FM 94 editions 2-4: section 1 flags the optional section 2, section 3 carries the
+    // subset count and the observed/compressed flags, and section 4 data follows a reserved byte.
+    Wmo,
+};
+
+// Shape of the contour drawn around each cluster.
+enum class ContourMode {
+    // Convex hull of the cell vertices; overlapping hulls of one phenomenon are merged.
+    Hull,
+    // Traced cell boundary, concave where the echo is and with holes for enclosed gaps.
+    Outline,
+};
+
+// Encoding of the rendered contour map.
+enum class ImageFormat {
+    Bmp,  // uncompressed 24-bit
+    Png,
+};
+
+// Which contour files a run writes.
+enum class ContourOutputFormat {
+    GeoJson,
+    // Indexed binary file (see contour_file.h) for consumers that should not parse text.
+    Binary,
+    Both,
+};
+
 struct PipelineConfig {
     std::string bufr_input;
     std::string csv_output_dir;
     std::string echo_tops_matrix;
     std::string merged_geojson_output;
+    std::string merged_binary_output;  // defaults to merged_geojson_output with a .rhcf extension
     std::string image_output_path;
     std::string tables_path;
+    std::string sequence_tables_path;  // optional Table D
     double radar_latitude = 0.0;
     double radar_longitude = 0.0;
     double radar_altitude_m = 0.0;
     double grid_cell_size_km = 1.0;
     std::size_t image_width = 1024;
     std::size_t image_height = 1024;
+    ImageFormat image_format = ImageFormat::Bmp;
+    bool image_palette = true;  // indexed-colour PNG when the map has at most 256 colours
+    std::string reflectivity_image_path;  // PPI of the reflectivity field; empty disables it
+    double reflectivity_max_range_km = 0.0;  // 0 fits the farthest gate
+    std::string tile_output_dir;  // XYZ tile pyramid; empty disables tiling
+    int tile_min_zoom = 6;
+    int tile_max_zoom = 10;
+    std::size_t decode_threads = 1;
+    std::size_t cluster_threads = 1;
+    std::size_t render_threads = 1;
+    BufrLayout bufr_layout = BufrLayout::Compact;
+    ContourMode contour_mode = ContourMode::Hull;
+    double simplify_tolerance_km = 0.0;  // 0 keeps every contour vertex
+    int geojson_precision = -1;          // coordinate decimals; negative keeps 6 significant digits
+    bool geojson_compact = false;
+    ContourOutputFormat contour_output_format = ContourOutputFormat::GeoJson;
     std::vector<double> reflectivity_thresholds;
     std::vector<std::string> allowed_phenomena;
 };
@@ -37,6 +87,8 @@ class ConfigLoader {
 public:
     static PipelineConfig load_pipeline(const std::string& path);
     static std::unordered_map<std::string, DescriptorDefinition> load_tables(const std::string& path);
+    // Table D: "3-XXX-YYY" keys mapped to the descriptors each sequence expands to.
+    static std::unordered_map<std::string, std::vector<std::string>> load_sequences(const std::string& path);
 };
 
 }  // namespace radar
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "radar/contour_merger.h"
+#include "radar/mapped_file.h"
+
+namespace radar {
+
+// Binary contour file, all fields little-endian:
+//
+//   header   48 bytes   "RHCF", u16 version, u16 reserved, u32 feature count, u32 reserved,
+//                       f64 min_lon, min_lat, max_lon, max_lat over every feature
+//   index    48 bytes   per feature: f64 min_lon, min_lat, max_lon, max_lat, u64 record
+//                       offset from the start of the file, u64 record size
+//   records             per feature, 8-byte aligned: char phenomenon[16] (NUL padded),
+//                       f64 threshold_dbz, f64 max_reflectivity, f64 max_echo_top_km (NaN when
+//                       absent), then the polygon as WKB (lon, lat; outer ring first)
+//
+// The index is read without touching the records, so a reader can pick the features whose
+// bounds it needs and decode only those.
+struct ContourFileEntry {
+    GeoBounds bounds;
+    std::uint64_t offset = 0;
+    std::uint64_t size = 0;
+};
+
+class ContourFileWriter {
+public:
+    static void write(const std::vector<MergedContour>& contours, const std::filesystem::path& path);
+};
+
+class ContourFileReader {
+public:
+    explicit ContourFileReader(const std::filesystem::path& path);
+
+    std::size_t size() const { return entries_.size(); }
+    const GeoBounds& bounds() const { return bounds_; }
+    const ContourFileEntry& entry(std::size_t feature) const { return entries_[feature]; }
+
+    MergedContour read(std::size_t feature) const;
+    // Features whose bounds intersect the query, in file order.
+    std::vector<std::size_t> query(const GeoBounds& area) const;
+
+private:
+    MappedFile file_;
+    GeoBounds bounds_;
+    std::vector<ContourFileEntry> entries_;
+};
+
+}  // namespace radar
@@ -5,15 +5,23 @@
 #include <vector>
 
 #include "radar/cluster_analyzer.h"
+#include "radar/config.h"
+#include "radar/geojson_writer.h"
 
 namespace radar {
 
 struct Polygon {
-    std::vector<GeoCoordinate> vertices;
+    std::vector<GeoCoordinate> vertices;  // closed outer ring
+    std::vector<std::vector<GeoCoordinate>> holes = {};  // closed interior rings
+};
+
+struct ContourMergeOptions {
+    ContourMode mode = ContourMode::Hull;
 };
 
 struct MergedContour {
     std::string phenomenon_type;
+    double threshold_dbz = 0.0;  // clustering threshold the contour was traced at
     Polygon geometry;
     double max_reflectivity = 0.0;
     std::optional<double> max_echo_top_km;
@@ -21,13 +29,27 @@ struct MergedContour {
 
 class ContourMerger {
 public:
-    std::vector<MergedContour> merge(const std::vector<Cluster>& clusters) const;
-    void write_geojson(const std::vector<MergedContour>& contours, const std::string& path) const;
+    explicit ContourMerger(ContourMergeOptions options = {});
+
+    std::vector<MergedContour> merge(const CellGrid& grid, const ClusterSet& clusters) const;
+    void write_geojson(const std::vector<MergedContour>& contours, const std::string& path,
+                       GeoJsonOptions options = {}) const;
 
 private:
+    std::vector<MergedContour> merge_outlines(const CellGrid& grid, const ClusterSet& clusters) const;
     Polygon convex_hull(const std::vector<GeoCoordinate>& points) const;
-    static bool bounding_boxes_intersect(const Polygon& a, const Polygon& b);
-    static Polygon merge_polygons(const Polygon& a, const Polygon& b);
+    static GeoBounds bounds_of(const Polygon& polygon);
+    static bool bounds_intersect(const GeoBounds& a, const GeoBounds& b);
+    // Hull of two convex_hull() results in linear time: each hull splits into two chains that
+    // are already sorted, so the points are merged rather than sorted again.
+    static Polygon merge_hulls(const Polygon& a, const Polygon& b);
+    // Groups contours of the same phenomenon whose bounds overlap, repeating with the grown
+    // group bounds until nothing changes. Returns the group of each contour, identified by its
+    // lowest contour index.
+    static std::vector<std::size_t> group_overlapping(const std::vector<MergedContour>& contours,
+                                                      std::vector<GeoBounds> bounds);
+
+    ContourMergeOptions options_;
 };
 
 }  // namespace radar
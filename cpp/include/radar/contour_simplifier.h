@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "radar/contour_merger.h"
+
+namespace radar {
+
+struct SimplifyOptions {
+    // Largest distance a removed vertex may lie from the simplified ring; 0 disables the stage.
+    double tolerance_km = 0.0;
+};
+
+struct SimplifyStats {
+    std::size_t vertices_before = 0;
+    std::size_t vertices_after = 0;
+
+    std::size_t removed() const { return vertices_before - vertices_after; }
+};
+
+// Douglas-Peucker over every ring of a contour set. Vertices that several rings share (nested
+// levels tracing the same cells, touching outlines) are kept, so shared boundaries stay shared,
+// and a run of vertices is only replaced by a chord when no vertex of another ring lies in the
+// area the chord would cut off, so rings never jump over one another.
+class ContourSimplifier {
+public:
+    explicit ContourSimplifier(SimplifyOptions options = {});
+
+    SimplifyStats simplify(std::vector<MergedContour>& contours) const;
+
+private:
+    SimplifyOptions options_;
+};
+
+}  // namespace radar
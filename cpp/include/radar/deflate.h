@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace radar {
+
+// Compresses `data` as raw DEFLATE (RFC 1951) with LZ77 matching and dynamic Huffman blocks,
+// appending to `out`; blocks that would not shrink are stored instead. Matches never reach back
+// past the start of `data`, so independently compressed chunks can be concatenated: every chunk
+// but the last is ended with an empty stored block to byte-align it, and the last one
+// (final = true) sets BFINAL.
+void deflate_compress(std::span<const std::uint8_t> data, bool final, std::vector<std::uint8_t>& out);
+
+// Checksums for zlib streams and PNG chunks.
+std::uint32_t adler32(std::span<const std::uint8_t> data, std::uint32_t adler = 1);
+// Adler-32 of A followed by B, from the checksums of A and of B and the length of B.
+std::uint32_t adler32_combine(std::uint32_t adler_a, std::uint32_t adler_b, std::size_t length_b);
+std::uint32_t crc32(std::span<const std::uint8_t> data, std::uint32_t crc = 0);
+
+}  // namespace radar
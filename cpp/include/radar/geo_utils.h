@@ -10,6 +10,13 @@ struct GeoCoordinate {
     double longitude_deg = 0.0;
 };
 
+struct GeoBounds {
+    double min_latitude_deg = 0.0;
+    double max_latitude_deg = 0.0;
+    double min_longitude_deg = 0.0;
+    double max_longitude_deg = 0.0;
+};
+
 struct RadarObservation {
     double azimuth_deg = 0.0;
     double range_km = 0.0;
@@ -21,11 +28,16 @@ struct CellGeometry {
     std::array<GeoCoordinate, 4> vertices;
 };
 
+// Area of the cell's quadrilateral, projected onto a plane tangent at its centre.
+double cell_area_km2(const CellGeometry& cell);
+
 class GeoCalculator {
 public:
     GeoCalculator(double radar_lat_deg, double radar_lon_deg, double radar_alt_m);
 
     CellGeometry compute_geometry(const RadarObservation& obs, double gate_length_km) const;
+    // Centre of compute_geometry() alone.
+    GeoCoordinate compute_center(const RadarObservation& obs) const;
 
 private:
     GeoCoordinate move(const GeoCoordinate& start, double distance_km, double azimuth_deg) const;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "radar/geo_utils.h"
+
+namespace radar {
+
+struct MergedContour;
+
+struct GeoJsonOptions {
+    // Digits after the decimal point for coordinates (5 is about a metre); negative keeps the
+    // stream default of six significant digits.
+    int coordinate_precision = -1;
+    // No indentation or spaces between tokens.
+    bool compact = false;
+};
+
+// Writes a FeatureCollection one feature at a time. Text is formatted with std::to_chars into a
+// buffer that goes to the file in large blocks, so memory stays bounded however many contours
+// are written.
+class GeoJsonWriter {
+public:
+    explicit GeoJsonWriter(const std::string& path, GeoJsonOptions options = {});
+    ~GeoJsonWriter();
+
+    GeoJsonWriter(const GeoJsonWriter&) = delete;
+    GeoJsonWriter& operator=(const GeoJsonWriter&) = delete;
+
+    void write(const MergedContour& contour);
+    // Closes the collection and flushes; further writes are an error.
+    void finish();
+
+private:
+    void append(std::string_view text) { buffer_.append(text); }
+    void append_number(double value, int precision);
+    void append_string(const std::string& value);
+    void append_ring(const std::vector<GeoCoordinate>& ring);
+    void flush_if_full();
+    void flush();
+
+    std::ofstream stream_;
+    GeoJsonOptions options_;
+    std::string buffer_;
+    std::size_t features_ = 0;
+    bool finished_ = false;
+};
+
+}  // namespace radar
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -12,6 +13,11 @@ struct ImageRenderOptions {
     std::size_t width = 1024;
     std::size_t height = 1024;
     double padding_ratio = 0.05;
+    // Threads painting horizontal bands; 0 uses every hardware thread. The image does not
+    // depend on the thread count.
+    std::size_t threads = 1;
+    ImageFormat format = ImageFormat::Bmp;
+    bool palette = true;  // PNG only: indexed colour when the map has at most 256 colours
 };
 
 class ImageRenderer {
@@ -20,11 +26,16 @@ public:
 
     void render(const std::vector<MergedContour>& contours, const std::string& output_path) const;
 
-private:
-    ImageRenderOptions options_;
+    // Writes a packed, top-down BGR buffer of options.width x options.height pixels in
+    // options.format.
+    static void write_image(std::span<const unsigned char> bgr, const ImageRenderOptions& options,
+                            const std::string& output_path);
 
-    static bool point_in_polygon(double lat, double lon, const Polygon& polygon);
+    // Fill colour of a phenomenon as 0xRRGGBBAA; shared with the tile renderer.
     static unsigned rgba_from_string(const std::string& key);
+
+private:
+    ImageRenderOptions options_;
 };
 
 }  // namespace radar
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace radar {
+
+// Read-only view over the full contents of a file. Regular files are memory-mapped so callers
+// can slice them without copying; inputs that cannot be mapped (pipes, character devices,
+// empty files, platforms without mmap) are read once into an owned buffer instead.
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    std::span<const std::uint8_t> bytes() const { return bytes_; }
+    bool is_mapped() const { return mapping_ != nullptr; }
+
+private:
+    void release();
+
+    void* mapping_ = nullptr;
+    std::size_t mapping_size_ = 0;
+    std::vector<std::uint8_t> fallback_;
+    std::span<const std::uint8_t> bytes_;
+};
+
+}  // namespace radar
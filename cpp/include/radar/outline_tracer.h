@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include "radar/cell_grid.h"
+#include "radar/cluster_analyzer.h"
+#include "radar/contour_merger.h"
+
+namespace radar {
+
+// Traces the true outline of each cluster along the edges of its cells, instead of hulling
+// them. Boundaries are followed crack by crack on the (row, column) lattice, so the work is
+// linear in the number of boundary edges, and enclosed gaps come out as holes.
+class OutlineTracer {
+public:
+    explicit OutlineTracer(const CellGrid& grid);
+
+    // One polygon per cluster, in cluster order. The outer ring runs counter-clockwise and
+    // holes clockwise in longitude/latitude, as GeoJSON expects.
+    std::vector<Polygon> trace(const ClusterSet& clusters) const;
+
+private:
+    const CellGrid& grid_;
+};
+
+}  // namespace radar
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace radar {
+
+// Maps a configured thread count to a usable one: 0 selects every hardware thread.
+inline std::size_t resolve_thread_count(std::size_t requested) {
+    if (requested != 0) {
+        return requested;
+    }
+    return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+// Runs fn(begin, end) over [0, count) in blocks of `grain` items. Blocks are handed out
+// dynamically to up to `threads` workers (the calling thread included); results must be written
+// to per-index slots for the output to stay deterministic. If blocks throw, the exception from
+// the lowest-numbered failing block is rethrown once every worker has stopped, which matches
+// what a sequential loop would have reported.
+template <typename Fn>
+void parallel_for(std::size_t count, std::size_t threads, std::size_t grain, Fn&& fn) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<std::size_t>(1, grain);
+    const std::size_t blocks = (count + grain - 1) / grain;
+    threads = std::min(resolve_thread_count(threads), blocks);
+    if (threads <= 1) {
+        fn(std::size_t{0}, count);
+        return;
+    }
+
+    std::atomic<std::size_t> next_block{0};
+    std::exception_ptr error;
+    std::size_t error_block = blocks;
+    std::mutex error_mutex;
+    auto worker = [&] {
+        while (true) {
+            std::size_t block = next_block.fetch_add(1, std::memory_order_relaxed);
+            if (block >= blocks) {
+                return;
+            }
+            try {
+                std::size_t begin = block * grain;
+                fn(begin, std::min(count, begin + grain));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (block < error_block) {
+                    error = std::current_exception();
+                    error_block = block;
+                }
+                // Blocks are handed out in order, so every lower block is already running.
+                next_block.store(blocks, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (std::size_t i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}  // namespace radar
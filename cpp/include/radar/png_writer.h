@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace radar {
+
+struct PngOptions {
+    // Indexed colour when the image has at most 256 colours, as contour maps do; truecolour
+    // otherwise.
+    bool palette = true;
+    // Threads filtering and compressing row blocks; 0 uses every hardware thread. The file does
+    // not depend on the thread count.
+    std::size_t threads = 1;
+};
+
+// Encodes a top-down, tightly packed BGR image (the renderer's buffer layout) as PNG. Rows are
+// split into blocks that are filtered and deflated independently and then concatenated into one
+// zlib stream.
+std::vector<std::uint8_t> encode_png(std::span<const std::uint8_t> bgr, std::size_t width, std::size_t height,
+                                     const PngOptions& options = {});
+void write_png(std::span<const std::uint8_t> bgr, std::size_t width, std::size_t height,
+               const std::string& output_path, const PngOptions& options = {});
+
+}  // namespace radar
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "radar/cell_grid.h"
+#include "radar/image_renderer.h"
+
+namespace radar {
+
+// dBZ -> colour table. Entry 0 is the background (no gate, no data or below min_dbz); entry
+// i >= 1 covers [min_dbz + (i - 1) * step_dbz, min_dbz + i * step_dbz), the last one open-ended.
+struct ReflectivityLut {
+    float min_dbz = -32.0f;
+    float step_dbz = 0.5f;
+    std::array<std::uint32_t, 256> bgrx{};  // 0x00RRGGBB, i.e. B, G, R, 0 in memory order
+
+    // The usual 5 dBZ reflectivity steps from 5 dBZ up; weaker echo is left as background.
+    static ReflectivityLut standard();
+
+    std::uint8_t index(float dbz) const;
+};
+
+// Colours one pixel per entry of gate_of_pixel from gate_dbz[gate] through the table, writing
+// packed BGR. kNoGate entries get the background. Uses AVX2 gathers when built with AVX2
+// (RADAR_ENABLE_AVX2), otherwise a scalar loop; both give identical bytes.
+constexpr std::uint32_t kNoGate = UINT32_MAX;
+void colour_gates(std::span<const std::uint32_t> gate_of_pixel, std::span<const float> gate_dbz,
+                  const ReflectivityLut& lut, unsigned char* bgr);
+
+struct ReflectivityRenderOptions {
+    std::size_t width = 1024;
+    std::size_t height = 1024;
+    double radar_latitude_deg = 0.0;
+    double radar_longitude_deg = 0.0;
+    double max_range_km = 0.0;  // half the map width; 0 fits the farthest gate
+    std::size_t threads = 1;    // 0 uses every hardware thread
+    ImageFormat format = ImageFormat::Bmp;
+    bool palette = true;
+};
+
+// Plan position indicator of the reflectivity field: a map centred on the radar where every
+// pixel shows the gate beneath it. The pixel -> gate mapping is worked out once, from the ray
+// azimuths and gate ranges of the grid passed to the constructor, so later scans of the same
+// volume layout only pay for a table lookup per pixel. Of a multi-elevation volume only the
+// lowest sweep with data is drawn. Pass grids holding every gate, not only the cells kept for
+// clustering: a thresholded grid leaves rays and gates out of the layout and weak echo out of
+// the image.
+class ReflectivityRenderer {
+public:
+    ReflectivityRenderer(const CellGrid& layout, ReflectivityRenderOptions options = {},
+                         ReflectivityLut lut = ReflectivityLut::standard());
+
+    void render(const CellGrid& grid, const std::string& output_path) const;
+    // Packed, top-down BGR pixels.
+    std::vector<unsigned char> render(const CellGrid& grid) const;
+
+private:
+    ReflectivityRenderOptions options_;
+    ReflectivityLut lut_;
+    GridExtent extent_;                        // gate slot = row-major position in this extent
+    std::vector<std::uint32_t> gate_of_pixel_;  // gate slot per pixel, or kNoGate
+};
+
+}  // namespace radar
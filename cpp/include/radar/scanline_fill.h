@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "radar/contour_merger.h"
+
+namespace radar {
+
+// Maps pixel centres of a width x height raster to a latitude/longitude rectangle and back,
+// rows running north to south. Any coordinates that are linear in the raster work, e.g.
+// Web Mercator northing and easting passed as latitude and longitude.
+class Viewport {
+public:
+    Viewport(double min_lat, double max_lat, double min_lon, double max_lon, std::size_t width, std::size_t height)
+        : min_lat_(min_lat), max_lat_(max_lat), min_lon_(min_lon), max_lon_(max_lon),
+          lat_span_(max_lat - min_lat), lon_span_(max_lon - min_lon), width_(width), height_(height) {}
+
+    std::size_t width() const { return width_; }
+
+    double x_to_lon(std::size_t x) const {
+        if (lon_span_ <= 0.0) {
+            return (min_lon_ + max_lon_) * 0.5;
+        }
+        double ratio = (static_cast<double>(x) + 0.5) / static_cast<double>(width_);
+        return min_lon_ + ratio * lon_span_;
+    }
+
+    double y_to_lat(std::size_t y) const {
+        if (lat_span_ <= 0.0) {
+            return (min_lat_ + max_lat_) * 0.5;
+        }
+        double ratio = (static_cast<double>(y) + 0.5) / static_cast<double>(height_);
+        return max_lat_ - ratio * lat_span_;
+    }
+
+    double lon_to_x_index(double lon) const {
+        if (lon_span_ <= 0.0 || width_ == 1) {
+            return 0.0;
+        }
+        double ratio = (lon - min_lon_) / lon_span_;
+        return std::max(0.0, std::min(ratio, 1.0)) * static_cast<double>(width_ - 1);
+    }
+
+    double lat_to_y_index(double lat) const {
+        if (lat_span_ <= 0.0 || height_ == 1) {
+            return 0.0;
+        }
+        double ratio = (max_lat_ - lat) / lat_span_;
+        return std::max(0.0, std::min(ratio, 1.0)) * static_cast<double>(height_ - 1);
+    }
+
+    // Unclamped, approximate inverses of x_to_lon / y_to_lat; callers correct by a pixel.
+    double lon_to_x(double lon) const {
+        return lon_span_ <= 0.0 ? 0.0 : (lon - min_lon_) / lon_span_ * static_cast<double>(width_) - 0.5;
+    }
+    double lat_to_y(double lat) const {
+        return lat_span_ <= 0.0 ? 0.0 : (max_lat_ - lat) / lat_span_ * static_cast<double>(height_) - 0.5;
+    }
+
+private:
+    double min_lat_;
+    double max_lat_;
+    double min_lon_;
+    double max_lon_;
+    double lat_span_;
+    double lon_span_;
+    std::size_t width_;
+    std::size_t height_;
+};
+
+// Inclusive pixel rectangle.
+struct PixelBox {
+    int min_x = 0;
+    int max_x = 0;
+    int min_y = 0;
+    int max_y = 0;
+};
+
+// Even-odd scanline fill with an active edge table, painting BGR pixels of a top-down buffer
+// laid out as the viewport. A pixel is painted exactly when an even-odd test of its centre against
+// every ring would report it inside: for each row the crossings are computed with one expression
+// and a half-open rule, so a row crosses each ring an even number of times and the centres
+// between the 1st and 2nd, 3rd and 4th, ... crossing are the inside ones. Holes need no special
+// handling. The scratch buffers are reused between fills, so keep one filler per thread.
+class ScanlineFiller {
+public:
+    ScanlineFiller(const Viewport& view, unsigned char* buffer) : view_(view), buffer_(buffer) {}
+
+    // Paints the part of the polygon inside the box.
+    void fill(const Polygon& polygon, const PixelBox& box, std::array<unsigned char, 3> bgr);
+
+private:
+    // Endpoints keep the roles they have in the crossing formula: i is the later vertex.
+    struct Edge {
+        double xi, yi, xj, yj;
+        int first_row, last_row;  // rows whose centre latitude may lie between yi and yj
+    };
+
+    void add_ring(const std::vector<GeoCoordinate>& ring, const PixelBox& box);
+    // Leftmost column in the box whose centre longitude is >= lon, or max_x + 1.
+    int first_x_at_or_after(double lon, const PixelBox& box) const;
+
+    const Viewport& view_;
+    unsigned char* buffer_;
+    std::vector<Edge> edges_;
+    std::vector<const Edge*> active_;
+    std::vector<double> crossings_;
+};
+
+}  // namespace radar
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include "radar/contour_merger.h"
+
+namespace radar {
+
+struct TileOptions {
+    int min_zoom = 6;
+    int max_zoom = 10;
+    // Threads rendering tiles; 0 uses every hardware thread.
+    std::size_t threads = 1;
+    bool palette = true;  // indexed-colour PNG tiles
+};
+
+struct TileStats {
+    std::size_t tiles = 0;      // non-empty tiles in this scan
+    std::size_t written = 0;    // new or changed
+    std::size_t unchanged = 0;  // same content hash as the previous scan, left in place
+    std::size_t removed = 0;    // tiles of the previous scan that are now empty
+};
+
+// Renders contours as an XYZ pyramid of 256x256 Web Mercator PNG tiles,
+// <output_dir>/<z>/<x>/<y>.png, drawn with the same fill and colours as ImageRenderer. Only tiles
+// that contour bounds reach are rendered, and tiles that come out blank are not stored.
+// <output_dir>/manifest.txt records a hash of each stored tile's pixels and PNG encoding: on the
+// next scan tiles whose hash is unchanged are not rewritten, and tiles that no longer hold
+// contours are deleted along with tile directories left empty.
+class TileRenderer {
+public:
+    static constexpr std::size_t kTileSize = 256;
+    static constexpr int kMaxZoom = 24;
+
+    explicit TileRenderer(std::filesystem::path output_dir, TileOptions options = {});
+
+    TileStats render(const std::vector<MergedContour>& contours) const;
+
+private:
+    std::filesystem::path output_dir_;
+    TileOptions options_;
+};
+
+}  // namespace radar
@@ -0,0 +1,59 @@
+#include "radar/bit_reader.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace radar {
+
+void BitReader::read_many(std::size_t bit_count, std::size_t count, std::uint32_t* out) {
+    if (bit_count > kMaxFieldBits) {
+        fail(bit_count);
+    }
+    if (bit_count != 0 && count > remaining_bits() / bit_count) {
+        fail_end_of_stream();
+    }
+    if (bit_count == 0) {
+        std::fill(out, out + count, 0u);
+        return;
+    }
+    // Bounds are checked once for the whole run; only fields whose 8-byte window crosses the
+    // end of the buffer take the zero-padded tail load.
+    const std::size_t shift = 64 - bit_count;
+    std::size_t pos = bit_pos_;
+    for (std::size_t i = 0; i < count; ++i, pos += bit_count) {
+        out[i] = static_cast<std::uint32_t>((load_word(pos / 8) << (pos % 8)) >> shift);
+    }
+    bit_pos_ = pos;
+}
+
+void BitReader::skip_bits(std::size_t bit_count) {
+    if (bit_count > remaining_bits()) {
+        fail_end_of_stream();
+    }
+    bit_pos_ += bit_count;
+}
+
+std::uint64_t BitReader::load_tail(std::size_t byte_index) const {
+    std::uint64_t word = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+        word <<= 8;
+        if (byte_index + i < buffer_.size()) {
+            word |= buffer_[byte_index + i];
+        }
+    }
+    return word;
+}
+
+void BitReader::fail(std::size_t bit_count) const {
+    if (bit_count > kMaxFieldBits) {
+        throw std::runtime_error("BUFR field width of " + std::to_string(bit_count) + " bits is not supported");
+    }
+    fail_end_of_stream();
+}
+
+void BitReader::fail_end_of_stream() {
+    throw std::runtime_error("Attempt to read past end of BUFR bitstream");
+}
+
+}  // namespace radar
@@ -1,157 +1,606 @@
 #include "radar/bufr_decoder.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
-#include <fstream>
+#include <cstring>
+#include <limits>
+#include <mutex>
 #include <stdexcept>
 
+#include "radar/mapped_file.h"
+#include "radar/parallel.h"
+
 namespace radar {
 
 namespace {
 constexpr std::size_t kSectionHeaderSize = 3;
+constexpr std::size_t kSection0Size = 8;
+// Messages handed to a worker at a time; large enough to amortise the plan lookup.
+constexpr std::size_t kMessagesPerBlock = 256;
+constexpr std::size_t kIncrementWidthBits = 6;        // NBINC field of compressed data
+constexpr std::uint8_t kOptionalSectionFlag = 0x80;  // section 1: section 2 present
+constexpr std::uint8_t kCompressedFlag = 0x40;       // section 3: compressed data
+constexpr int kReplicationFactorClass = 31;          // class 0-031: delayed replication factors
+constexpr std::size_t kMaxSequenceDepth = 32;        // guards against self-referencing Table D entries
+
+using ByteSpan = std::span<const std::uint8_t>;
 
-std::uint16_t read_uint16(const std::vector<std::uint8_t>& data, std::size_t offset) {
+std::uint16_t read_uint16(ByteSpan data, std::size_t offset) {
     return static_cast<std::uint16_t>((data[offset] << 8) | data[offset + 1]);
 }
 
-std::uint32_t read_uint24(const std::vector<std::uint8_t>& data, std::size_t offset) {
+std::uint32_t read_uint24(ByteSpan data, std::size_t offset) {
     return static_cast<std::uint32_t>((data[offset] << 16) | (data[offset + 1] << 8) | data[offset + 2]);
 }
 
-std::uint32_t read_uint32(const std::vector<std::uint8_t>& data, std::size_t offset) {
+std::uint32_t read_uint32(ByteSpan data, std::size_t offset) {
     return static_cast<std::uint32_t>((data[offset] << 24) | (data[offset + 1] << 16) |
                                       (data[offset + 2] << 8) | data[offset + 3]);
 }
 
-std::vector<std::uint8_t> read_section(std::ifstream& stream, std::size_t size) {
-    std::vector<std::uint8_t> data(size);
-    stream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
-    if (stream.gcount() != static_cast<std::streamsize>(size)) {
+// Returns a view of the next `size` bytes and advances `pos` past them.
+ByteSpan read_section(ByteSpan data, std::size_t& pos, std::size_t size) {
+    if (size > data.size() - pos) {
         throw std::runtime_error("Unexpected EOF while reading BUFR section");
     }
-    return data;
+    auto section = data.subspan(pos, size);
+    pos += size;
+    return section;
 }
 
-}  // namespace
+// Reads a 3-byte section length header followed by the section body.
+ByteSpan read_sized_section(ByteSpan data, std::size_t& pos, ByteSpan header) {
+    auto length = read_uint24(header, 0);
+    if (length < kSectionHeaderSize) {
+        throw std::runtime_error("Unexpected EOF while reading BUFR section");
+    }
+    return read_section(data, pos, length - kSectionHeaderSize);
+}
 
-BufrDecoder::BufrDecoder(std::unordered_map<std::string, DescriptorDefinition> tables)
-    : tables_(std::move(tables)) {}
+bool matches(ByteSpan data, const char (&tag)[5]) {
+    return data.size() == 4 && std::memcmp(data.data(), tag, 4) == 0;
+}
 
-std::vector<BufrMessage> BufrDecoder::decode_file(const std::filesystem::path& path) const {
-    std::ifstream stream(path, std::ios::binary);
-    if (!stream.is_open()) {
-        throw std::runtime_error("Cannot open BUFR file: " + path.string());
+struct MessageSections {
+    ByteSpan descriptors;  // section-3 descriptor list
+    ByteSpan data;         // section-4 bit stream
+    std::size_t subsets = 1;
+    bool compressed = false;
+};
+
+// Walks the sections of the message starting at `pos` and advances `pos` past its "7777".
+MessageSections split_message(ByteSpan data, std::size_t& pos, BufrLayout layout) {
+    if (!matches(read_section(data, pos, 4), "BUFR")) {
+        throw std::runtime_error("Invalid BUFR start signature");
     }
 
-    std::vector<BufrMessage> messages;
-    while (stream) {
-        char header[4];
-        stream.read(header, 4);
-        if (!stream) {
-            break;
+    // Rest of section 0: total length and edition.
+    auto section0 = read_section(data, pos, 4);
+    const std::uint8_t edition = section0[3];
+
+    auto section1 = read_sized_section(data, pos, read_section(data, pos, kSectionHeaderSize));
+
+    auto header = read_section(data, pos, kSectionHeaderSize);
+    if (layout == BufrLayout::Wmo) {
+        // The optional-section flag is octet 10 of section 1 in edition 4 and octet 8 before it.
+        const std::size_t flag_index = edition >= 4 ? 6 : 4;
+        if (section1.size() <= flag_index) {
+            throw std::runtime_error("Section 1 is too small");
         }
-        if (std::string(header, 4) != "BUFR") {
-            throw std::runtime_error("Invalid BUFR start signature");
+        if (section1[flag_index] & kOptionalSectionFlag) {
+            read_sized_section(data, pos, header);
+            header = read_section(data, pos, kSectionHeaderSize);
+        }
+    } else {
+        // The compact layout always carries a section 2.
+        if (read_uint24(header, 0) < kSectionHeaderSize) {
+            throw std::runtime_error("Missing section 2 in compact BUFR message");
         }
+        read_sized_section(data, pos, header);
+        header = read_section(data, pos, kSectionHeaderSize);
+    }
 
-        // Section 0 already consumed (length 8). Skip rest of section 0.
-        stream.seekg(4, std::ios::cur);
+    auto section3 = read_sized_section(data, pos, header);
+    auto section4 = read_sized_section(data, pos, read_section(data, pos, kSectionHeaderSize));
 
-        // Section 1 length and data
-        auto section1_length = read_uint24(read_section(stream, kSectionHeaderSize), 0);
-        auto section1 = read_section(stream, section1_length - kSectionHeaderSize);
-        (void)section1;  // Not used explicitly but read to advance stream.
+    // Section 5 (7777)
+    if (data.size() - pos < 4 || !matches(read_section(data, pos, 4), "7777")) {
+        throw std::runtime_error("Invalid BUFR end signature");
+    }
 
-        // Section 2 optional: peek next 3 bytes to check length
-        auto header2 = read_section(stream, kSectionHeaderSize);
-        std::vector<std::uint8_t> section2;
-        if (header2[0] != 0 || header2[1] != 0 || header2[2] != 0) {
-            auto len2 = read_uint24(header2, 0);
-            section2 = read_section(stream, len2 - kSectionHeaderSize);
-            header2 = read_section(stream, kSectionHeaderSize);
+    // Descriptors are 2 bytes each; a trailing pad byte is ignored.
+    MessageSections sections;
+    if (layout == BufrLayout::Wmo) {
+        if (section3.size() < 4 || section4.empty()) {
+            throw std::runtime_error("Section 3 is too small");
+        }
+        sections.subsets = read_uint16(section3, 1);
+        sections.compressed = (section3[3] & kCompressedFlag) != 0;
+        sections.descriptors = section3.subspan(4, (section3.size() - 4) & ~std::size_t{1});
+        sections.data = section4.subspan(1);
+    } else {
+        if (section3.empty()) {
+            throw std::runtime_error("Section 3 is too small");
         }
-        (void)section2;
+        sections.descriptors = section3.subspan(1, (section3.size() - 1) & ~std::size_t{1});
+        sections.data = section4;
+    }
+    return sections;
+}
+
+template <typename Descriptor>
+std::string descriptor_key(const Descriptor& descriptor) {
+    char key[16];
+    std::snprintf(key, sizeof(key), "%d-%03d-%03d", descriptor.f, descriptor.x, descriptor.y);
+    return key;
+}
+
+std::uint64_t fnv1a(ByteSpan data) {
+    std::uint64_t hash = 14695981039346656037ull;
+    for (auto byte : data) {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Turns a column of compressed-data increments into values. Branch-free over contiguous arrays
+// so it vectorises; missing subsets (all-ones increment) become NaN. The integer sums are exact
+// in double precision, so values match the uncompressed (raw + reference) / 10^scale.
+void unpack_increments(const std::uint32_t* increments, std::size_t count, double base, std::uint32_t missing,
+                       double divisor, double* out) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (std::size_t i = 0; i < count; ++i) {
+        const double value = (static_cast<double>(increments[i]) + base) / divisor;
+        out[i] = increments[i] == missing ? nan : value;
+    }
+}
 
-        auto len3 = read_uint24(header2, 0);
-        auto section3 = read_section(stream, len3 - kSectionHeaderSize);
+void emit_subsets(std::size_t index, const std::vector<DecodedValue>& values, const std::vector<std::size_t>& offsets,
+                  const std::vector<std::uint32_t>& item_parents,
+                  const std::vector<std::pair<std::size_t, std::size_t>>& item_ranges, const BufrMessageSink& sink) {
+    std::span<const DecodedValue> all(values);
+    std::span<const std::uint32_t> parents(item_parents);
+    for (std::size_t subset = 0; subset + 1 < offsets.size(); ++subset) {
+        const auto [items_begin, items_end] = item_ranges[subset];
+        sink(BufrMessageView{index, subset, all.subspan(offsets[subset], offsets[subset + 1] - offsets[subset]),
+                             parents.subspan(items_begin, items_end - items_begin)});
+    }
+}
+
+}  // namespace
 
-        auto header4 = read_section(stream, kSectionHeaderSize);
-        auto len4 = read_uint24(header4, 0);
-        auto section4 = read_section(stream, len4 - kSectionHeaderSize);
+struct BufrDecoder::PlanCache {
+    std::mutex mutex;
+    std::unordered_multimap<std::uint64_t, std::shared_ptr<const DecodePlan>> plans;
+};
 
-        // Section 5 (7777)
-        char trailer[4];
-        stream.read(trailer, 4);
-        if (std::string(trailer, 4) != "7777") {
-            throw std::runtime_error("Invalid BUFR end signature");
+BufrDecoder::BufrDecoder(std::unordered_map<std::string, DescriptorDefinition> tables, BufrDecoderOptions options)
+    : BufrDecoder(std::move(tables), {}, options) {}
+
+BufrDecoder::BufrDecoder(std::unordered_map<std::string, DescriptorDefinition> tables,
+                         std::unordered_map<std::string, std::vector<std::string>> sequences, BufrDecoderOptions options)
+    : plans_(std::make_unique<PlanCache>()), options_(options) {
+    // Ids are assigned in descriptor order so they are stable regardless of hash-map iteration order.
+    std::vector<std::pair<std::uint16_t, DescriptorDefinition>> entries;
+    entries.reserve(tables.size());
+    for (auto& [key, definition] : tables) {
+        Descriptor descriptor;
+        if (!parse_key(key, descriptor)) {
+            continue;  // Never addressable from a section 3.
         }
+        entries.emplace_back(pack(descriptor), std::move(definition));
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    definitions_.reserve(entries.size());
+    for (auto& [code, definition] : entries) {
+        ids_by_code_.emplace(code, static_cast<std::uint32_t>(definitions_.size()));
+        definitions_.push_back(std::move(definition));
+    }
 
-        auto descriptors = parse_section3(section3);
-        BitReader reader(section4);
-        auto values = decode_data(reader, descriptors);
-        messages.push_back(BufrMessage{std::move(values)});
+    for (const auto& [key, members] : sequences) {
+        Descriptor sequence;
+        if (!parse_key(key, sequence) || sequence.f != 3) {
+            throw std::runtime_error("Invalid sequence descriptor: " + key);
+        }
+        std::vector<Descriptor> expansion;
+        expansion.reserve(members.size());
+        for (const auto& member : members) {
+            Descriptor descriptor;
+            if (!parse_key(member, descriptor)) {
+                throw std::runtime_error("Invalid descriptor " + member + " in sequence " + key);
+            }
+            expansion.push_back(descriptor);
+        }
+        sequences_.emplace(pack(sequence), std::move(expansion));
     }
+}
+
+BufrDecoder::~BufrDecoder() = default;
+BufrDecoder::BufrDecoder(BufrDecoder&&) noexcept = default;
+BufrDecoder& BufrDecoder::operator=(BufrDecoder&&) noexcept = default;
+
+std::vector<BufrMessage> BufrDecoder::decode_file(const std::filesystem::path& path) const {
+    MappedFile file(path);
+    return decode_buffer(file.bytes());
+}
 
+std::vector<BufrMessage> BufrDecoder::decode_buffer(std::span<const std::uint8_t> data) const {
+    std::vector<BufrMessage> messages;
+    decode_buffer(data, [&](const BufrMessageView& view) {
+        BufrMessage message;
+        message.values.reserve(view.values.size());
+        for (const auto& value : view.values) {
+            const auto& def = definitions_[value.descriptor_id];
+            message.values.push_back(BufrValue{def.mnemonic, value.value, def.unit, value.item});
+        }
+        message.item_parents.assign(view.item_parents.begin(), view.item_parents.end());
+        messages.push_back(std::move(message));
+    });
     return messages;
 }
 
-std::uint32_t BufrDecoder::BitReader::read_bits(std::size_t bit_count) const {
-    std::uint32_t value = 0;
-    for (std::size_t i = 0; i < bit_count; ++i) {
-        if (bit_pos >= buffer.size() * 8) {
-            throw std::runtime_error("Attempt to read past end of BUFR bitstream");
+std::size_t BufrDecoder::decode_file(const std::filesystem::path& path, const BufrMessageSink& sink) const {
+    MappedFile file(path);
+    return decode_buffer(file.bytes(), sink);
+}
+
+std::size_t BufrDecoder::decode_buffer(std::span<const std::uint8_t> data, const BufrMessageSink& sink) const {
+    auto boundaries = scan_messages(data);
+    const std::size_t threads = resolve_thread_count(options_.threads);
+
+    if (threads <= 1 || boundaries.size() <= kMessagesPerBlock) {
+        DecodeScratch scratch;
+        DecodedMessage decoded;
+        for (std::size_t i = 0; i < boundaries.size(); ++i) {
+            decode_message(boundaries[i], scratch, decoded);
+            emit_subsets(i, decoded.values, decoded.subset_offsets, decoded.item_parents, decoded.item_ranges, sink);
+        }
+        return boundaries.size();
+    }
+
+    // Slots are reused across windows, so steady-state decoding does not allocate.
+    const std::size_t window = threads * kMessagesPerBlock;
+    std::vector<DecodedMessage> slots(std::min(window, boundaries.size()));
+    for (std::size_t base = 0; base < boundaries.size(); base += window) {
+        const std::size_t count = std::min(window, boundaries.size() - base);
+        parallel_for(count, threads, kMessagesPerBlock, [&](std::size_t begin, std::size_t end) {
+            DecodeScratch scratch;
+            for (std::size_t i = begin; i < end; ++i) {
+                decode_message(boundaries[base + i], scratch, slots[i]);
+            }
+        });
+        for (std::size_t i = 0; i < count; ++i) {
+            emit_subsets(base + i, slots[i].values, slots[i].subset_offsets, slots[i].item_parents,
+                         slots[i].item_ranges, sink);
         }
-        std::size_t byte_index = bit_pos / 8;
-        std::size_t bit_index = 7 - (bit_pos % 8);
-        std::uint8_t bit = (buffer[byte_index] >> bit_index) & 1;
-        value = (value << 1) | bit;
-        ++bit_pos;
     }
-    return value;
+    return boundaries.size();
 }
 
-DescriptorDefinition BufrDecoder::resolve(const Descriptor& descriptor) const {
-    char key[16];
-    std::snprintf(key, sizeof(key), "%d-%03d-%03d", descriptor.f, descriptor.x, descriptor.y);
-    auto it = tables_.find(key);
-    if (it == tables_.end()) {
-        throw std::runtime_error("Descriptor not found in tables: " + std::string(key));
+std::vector<std::span<const std::uint8_t>> BufrDecoder::scan_messages(std::span<const std::uint8_t> data) const {
+    std::vector<ByteSpan> messages;
+    std::size_t pos = 0;
+    while (data.size() - pos >= 4) {
+        if (!matches(data.subspan(pos, 4), "BUFR")) {
+            throw std::runtime_error("Invalid BUFR start signature");
+        }
+        std::size_t end = pos;
+        if (data.size() - pos >= kSection0Size) {
+            std::size_t total = read_uint24(data, pos + 4);
+            if (total >= kSection0Size + 4 && total <= data.size() - pos &&
+                matches(data.subspan(pos + total - 4, 4), "7777")) {
+                end = pos + total;
+            }
+        }
+        if (end == pos) {
+            // Producers that leave the section-0 length unset: walk the section lengths instead.
+            split_message(data, end, options_.layout);
+        }
+        messages.push_back(data.subspan(pos, end - pos));
+        pos = end;
     }
-    return it->second;
+    return messages;
 }
 
-std::vector<BufrDecoder::Descriptor> BufrDecoder::parse_section3(const std::vector<std::uint8_t>& section) const {
-    if (section.size() < 1) {
-        throw std::runtime_error("Section 3 is too small");
+void BufrDecoder::decode_message(std::span<const std::uint8_t> message, DecodeScratch& scratch,
+                                 DecodedMessage& out) const {
+    std::size_t pos = 0;
+    auto sections = split_message(message, pos, options_.layout);
+
+    // Volumes repeat one section 3, so the previous plan almost always matches.
+    const auto signature = sections.descriptors;
+    if (scratch.plan == nullptr || !std::equal(scratch.plan->signature.begin(), scratch.plan->signature.end(),
+                                               signature.begin(), signature.end())) {
+        scratch.plan = &plan_for(signature);
+    }
+
+    out.values.clear();
+    out.subset_offsets.clear();
+    out.item_parents.clear();
+    out.item_ranges.clear();
+    BitReader reader(sections.data);
+    if (sections.compressed) {
+        decode_compressed(reader, *scratch.plan, sections.subsets, scratch, out);
+        return;
+    }
+    // Uncompressed subsets follow each other, each carrying the full descriptor sequence.
+    for (std::size_t subset = 0; subset < sections.subsets; ++subset) {
+        out.subset_offsets.push_back(out.values.size());
+        const std::size_t items_begin = out.item_parents.size();
+        decode_data(reader, *scratch.plan, out);
+        out.item_ranges.emplace_back(items_begin, out.item_parents.size());
     }
-    std::size_t pos = 1;  // Skip reserved byte after flags.
-    std::vector<Descriptor> descriptors;
-    while (pos + 1 < section.size()) {
+    out.subset_offsets.push_back(out.values.size());
+}
+
+// Parses a table key of the form "F-XXX-YYY".
+bool BufrDecoder::parse_key(const std::string& key, Descriptor& descriptor) {
+    char tail = 0;
+    return std::sscanf(key.c_str(), "%d-%d-%d%c", &descriptor.f, &descriptor.x, &descriptor.y, &tail) == 3 &&
+           descriptor.f >= 0 && descriptor.f <= 3 && descriptor.x >= 0 && descriptor.x <= 63 && descriptor.y >= 0 &&
+           descriptor.y <= 255;
+}
+
+std::uint32_t BufrDecoder::resolve(const Descriptor& descriptor) const {
+    auto it = ids_by_code_.find(pack(descriptor));
+    if (it == ids_by_code_.end()) {
+        throw std::runtime_error("Descriptor not found in tables: " + descriptor_key(descriptor));
+    }
+    return it->second;
+}
+
+std::vector<BufrDecoder::Descriptor> BufrDecoder::parse_section3(std::span<const std::uint8_t> descriptors) const {
+    std::vector<Descriptor> result;
+    result.reserve(descriptors.size() / 2);
+    for (std::size_t pos = 0; pos + 1 < descriptors.size(); pos += 2) {
         Descriptor descriptor;
-        descriptor.f = (section[pos] & 0b11000000) >> 6;
-        descriptor.x = section[pos] & 0b00111111;
-        descriptor.y = section[pos + 1];
-        descriptors.push_back(descriptor);
-        pos += 2;
+        descriptor.f = (descriptors[pos] & 0b11000000) >> 6;
+        descriptor.x = descriptors[pos] & 0b00111111;
+        descriptor.y = descriptors[pos + 1];
+        result.push_back(descriptor);
     }
-    return descriptors;
+    return result;
 }
 
-std::vector<BufrValue> BufrDecoder::decode_data(const BitReader& reader, const std::vector<Descriptor>& descriptors) const {
-    std::vector<BufrValue> values;
-    for (const auto& descriptor : descriptors) {
-        auto def = resolve(descriptor);
-        if (def.bits == 0) {
+const BufrDecoder::DecodePlan& BufrDecoder::plan_for(std::span<const std::uint8_t> descriptors) const {
+    auto hash = fnv1a(descriptors);
+
+    std::lock_guard<std::mutex> lock(plans_->mutex);
+    auto [first, last] = plans_->plans.equal_range(hash);
+    for (auto it = first; it != last; ++it) {
+        const auto& cached = it->second->signature;
+        if (std::equal(cached.begin(), cached.end(), descriptors.begin(), descriptors.end())) {
+            return *it->second;
+        }
+    }
+    auto plan = compile_plan(descriptors);
+    return *plans_->plans.emplace(hash, std::move(plan))->second;
+}
+
+std::shared_ptr<const BufrDecoder::DecodePlan> BufrDecoder::compile_plan(std::span<const std::uint8_t> descriptors) const {
+    auto plan = std::make_shared<DecodePlan>();
+    plan->signature.assign(descriptors.begin(), descriptors.end());
+    expand(parse_section3(descriptors), *plan, 0);
+    return plan;
+}
+
+// Appends the steps for `descriptors`, expanding Table D sequences in place. A replication
+// becomes a factor step (or a fixed repeat step) followed by its expanded body.
+void BufrDecoder::expand(std::span<const Descriptor> descriptors, DecodePlan& plan, std::size_t depth) const {
+    if (depth > kMaxSequenceDepth) {
+        throw std::runtime_error("BUFR sequence nesting is too deep");
+    }
+    for (std::size_t i = 0; i < descriptors.size(); ++i) {
+        const auto& descriptor = descriptors[i];
+        if (descriptor.f == 3) {
+            auto it = sequences_.find(pack(descriptor));
+            if (it == sequences_.end()) {
+                throw std::runtime_error("Sequence not found in tables: " + descriptor_key(descriptor));
+            }
+            expand(it->second, plan, depth + 1);
             continue;
         }
-        auto raw = reader.read_bits(static_cast<std::size_t>(def.bits));
-        if (raw == static_cast<std::uint32_t>((1u << def.bits) - 1)) {
+        if (descriptor.f != 1) {
+            auto step = element_step(descriptor);
+            if (step.bits != 0) {
+                plan.steps.push_back(step);
+            }
+            continue;
+        }
+
+        // Replication 1-XXX-YYY: the next XXX descriptors repeat YYY times, or a number of times
+        // read from the factor descriptor that follows when YYY is 0.
+        const bool delayed = descriptor.y == 0;
+        const std::size_t body_begin = i + 1 + (delayed ? 1 : 0);
+        const auto width = static_cast<std::size_t>(descriptor.x);
+        if (body_begin + width > descriptors.size()) {
+            throw std::runtime_error("Replication extends past end of descriptor list: " + descriptor_key(descriptor));
+        }
+        auto body = descriptors.subspan(body_begin, width);
+        if (delayed) {
+            const auto& factor = descriptors[i + 1];
+            if (factor.f != 0 || factor.x != kReplicationFactorClass) {
+                throw std::runtime_error("Delayed replication without a factor descriptor: " +
+                                         descriptor_key(descriptor));
+            }
+            auto step = element_step(factor);
+            if (step.bits == 0) {
+                throw std::runtime_error("Delayed replication factor has no width: " + descriptor_key(factor));
+            }
+            const std::size_t factor_index = plan.steps.size();
+            plan.steps.push_back(step);
+            expand(body, plan, depth + 1);
+            plan.steps[factor_index].replicated = static_cast<std::uint32_t>(plan.steps.size() - factor_index - 1);
+            plan.has_replication = true;
+        } else {
+            const std::size_t repeat_index = plan.steps.size();
+            DecodeStep repeat;
+            repeat.repeats = static_cast<std::uint32_t>(descriptor.y);
+            plan.steps.push_back(repeat);
+            expand(body, plan, depth + 1);
+            plan.steps[repeat_index].replicated = static_cast<std::uint32_t>(plan.steps.size() - repeat_index - 1);
+            if (plan.steps[repeat_index].replicated == 0) {
+                plan.steps.pop_back();  // nothing to repeat
+            } else {
+                plan.has_replication = true;
+            }
+        }
+        i = body_begin + width - 1;
+    }
+}
+
+BufrDecoder::DecodeStep BufrDecoder::element_step(const Descriptor& descriptor) const {
+    auto id = resolve(descriptor);
+    const auto& def = definitions_[id];
+    DecodeStep step;
+    step.descriptor_id = id;
+    if (def.bits == 0) {
+        return step;
+    }
+    if (def.bits < 0 || static_cast<std::size_t>(def.bits) > BitReader::kMaxFieldBits) {
+        throw std::runtime_error("Unsupported bit width for descriptor " + def.mnemonic);
+    }
+    step.bits = static_cast<std::uint32_t>(def.bits);
+    step.missing = static_cast<std::uint32_t>((std::uint64_t{1} << def.bits) - 1);
+    step.reference = def.reference;
+    step.scale_divisor = std::pow(10.0, def.scale);
+    return step;
+}
+
+void BufrDecoder::decode_data(BitReader& reader, const DecodePlan& plan, DecodedMessage& out) const {
+    const std::size_t items_begin = out.item_parents.size();
+    out.item_parents.push_back(0);  // item 0, outside any replication
+    if (plan.has_replication) {
+        decode_steps(reader, plan.steps, 0, items_begin, out);
+        return;
+    }
+    for (const auto& step : plan.steps) {
+        auto raw = reader.read_bits(step.bits);
+        if (raw == step.missing) {
             continue;  // Missing value
         }
-        double value = (static_cast<double>(raw) + def.reference) / std::pow(10.0, def.scale);
-        values.push_back(BufrValue{def.mnemonic, value, def.unit});
+        out.values.push_back(
+            DecodedValue{step.descriptor_id, 0, (static_cast<double>(raw) + step.reference) / step.scale_divisor});
+    }
+}
+
+// `item` is the repetition the steps are decoded in; each repetition of a replicated body
+// becomes a new item, numbered from the subset's `items_begin`.
+void BufrDecoder::decode_steps(BitReader& reader, std::span<const DecodeStep> steps, std::uint32_t item,
+                               std::size_t items_begin, DecodedMessage& out) const {
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        const auto& step = steps[i];
+        double factor = step.repeats;
+        if (step.bits != 0) {
+            auto raw = reader.read_bits(step.bits);
+            if (step.replicated == 0) {
+                if (raw != step.missing) {
+                    out.values.push_back(DecodedValue{
+                        step.descriptor_id, item, (static_cast<double>(raw) + step.reference) / step.scale_divisor});
+                }
+                continue;
+            }
+            if (raw == step.missing) {
+                throw std::runtime_error("Missing delayed replication factor in BUFR data");
+            }
+            factor = (static_cast<double>(raw) + step.reference) / step.scale_divisor;
+            out.values.push_back(DecodedValue{step.descriptor_id, item, factor});
+        }
+        auto body = steps.subspan(i + 1, step.replicated);
+        for (auto repeat = static_cast<std::size_t>(factor); repeat > 0; --repeat) {
+            const auto repetition = static_cast<std::uint32_t>(out.item_parents.size() - items_begin);
+            out.item_parents.push_back(item);
+            decode_steps(reader, body, repetition, items_begin, out);
+        }
+        i += step.replicated;
+    }
+}
+
+void BufrDecoder::decode_compressed(BitReader& reader, const DecodePlan& plan, std::size_t subsets,
+                                    DecodeScratch& scratch, DecodedMessage& out) const {
+    // Compressed data stores, per descriptor, a minimum R0, an increment width NBINC and one
+    // NBINC-bit increment per subset. Each descriptor is unpacked into a contiguous column.
+    scratch.columns.clear();
+    scratch.column_ids.clear();
+    scratch.column_items.clear();
+    scratch.increments.resize(subsets);
+    out.item_parents.push_back(0);
+    unpack_columns(reader, plan.steps, subsets, 0, scratch, out.item_parents);
+
+    // Hand subsets out row by row, skipping missing values as uncompressed decoding does.
+    const std::size_t columns = scratch.column_ids.size();
+    out.values.reserve(columns * subsets);
+    for (std::size_t subset = 0; subset < subsets; ++subset) {
+        out.subset_offsets.push_back(out.values.size());
+        out.item_ranges.emplace_back(0, out.item_parents.size());
+        for (std::size_t k = 0; k < columns; ++k) {
+            const double value = scratch.columns[k * subsets + subset];
+            if (!std::isnan(value)) {
+                out.values.push_back(DecodedValue{scratch.column_ids[k], scratch.column_items[k], value});
+            }
+        }
+    }
+    out.subset_offsets.push_back(out.values.size());
+}
+
+void BufrDecoder::unpack_columns(BitReader& reader, std::span<const DecodeStep> steps, std::size_t subsets,
+                                 std::uint32_t item, DecodeScratch& scratch,
+                                 std::vector<std::uint32_t>& item_parents) const {
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        const auto& step = steps[i];
+        if (step.bits == 0) {
+            // Fixed replication: no data of its own.
+            auto body = steps.subspan(i + 1, step.replicated);
+            for (auto repeat = step.repeats; repeat > 0; --repeat) {
+                const auto repetition = static_cast<std::uint32_t>(item_parents.size());
+                item_parents.push_back(item);
+                unpack_columns(reader, body, subsets, repetition, scratch, item_parents);
+            }
+            i += step.replicated;
+            continue;
+        }
+        const std::size_t offset = scratch.columns.size();
+        scratch.columns.resize(offset + subsets);
+        scratch.column_ids.push_back(step.descriptor_id);
+        scratch.column_items.push_back(item);
+        double* column = scratch.columns.data() + offset;
+
+        const auto minimum = reader.read_bits(step.bits);
+        const auto width = reader.read_bits(kIncrementWidthBits);
+        if (width == 0) {
+            // Every subset has the same value, or every subset is missing.
+            const double value = minimum == step.missing
+                                     ? std::numeric_limits<double>::quiet_NaN()
+                                     : (static_cast<double>(minimum) + step.reference) / step.scale_divisor;
+            std::fill(column, column + subsets, value);
+        } else if (step.replicated != 0) {
+            throw std::runtime_error("Delayed replication factor differs between compressed subsets");
+        } else if (width > BitReader::kMaxFieldBits) {
+            throw std::runtime_error("Unsupported increment width in compressed BUFR data");
+        } else {
+            reader.read_many(width, subsets, scratch.increments.data());
+            const auto missing = static_cast<std::uint32_t>((std::uint64_t{1} << width) - 1);
+            unpack_increments(scratch.increments.data(), subsets, static_cast<double>(minimum) + step.reference,
+                              missing, step.scale_divisor, column);
+        }
+
+        if (step.replicated == 0) {
+            continue;
+        }
+        // Every subset shares the factor, so the body repeats as a whole.
+        if (minimum == step.missing) {
+            throw std::runtime_error("Missing delayed replication factor in BUFR data");
+        }
+        const double factor = column[0];
+        auto body = steps.subspan(i + 1, step.replicated);
+        for (auto repeat = static_cast<std::size_t>(factor); repeat > 0; --repeat) {
+            const auto repetition = static_cast<std::uint32_t>(item_parents.size());
+            item_parents.push_back(item);
+            unpack_columns(reader, body, subsets, repetition, scratch, item_parents);
+        }
+        i += step.replicated;
     }
-    return values;
 }
 
 }  // namespace radar
@@ -0,0 +1,58 @@
+#include "radar/cell_assembler.h"
+
+#include <algorithm>
+#include <string_view>
+
+namespace radar {
+
+namespace {
+
+constexpr std::string_view kMnemonics[GateRecord::kFieldCount] = {
+    "ROW", "COLUMN", "DBZH", "VRAD", "SWRAD", "AZIMUTH", "RANGE", "ELEVATION", "PHENOMENON",
+};
+
+}  // namespace
+
+CellAssembler::CellAssembler(const BufrDecoder& decoder, const EchoTops& echo_tops, CellAssemblyOptions options)
+    : field_by_id_(decoder.descriptor_count(), kUnmapped), echo_tops_(echo_tops), options_(std::move(options)) {
+    for (std::size_t id = 0; id < field_by_id_.size(); ++id) {
+        const auto& mnemonic = decoder.definition(static_cast<std::uint32_t>(id)).mnemonic;
+        auto it = std::find(std::begin(kMnemonics), std::end(kMnemonics), mnemonic);
+        if (it != std::end(kMnemonics)) {
+            field_by_id_[id] = static_cast<std::uint8_t>(it - std::begin(kMnemonics));
+        }
+    }
+}
+
+bool CellAssembler::build(const GateRecord& record, CellData& cell) const {
+    if (!record.has(GateField::Row) || !record.has(GateField::Column) || !record.has(GateField::Reflectivity)) {
+        return false;
+    }
+    cell.row = static_cast<int>(record.get(GateField::Row));
+    cell.column = static_cast<int>(record.get(GateField::Column));
+    cell.reflectivity_dbz = record.get(GateField::Reflectivity);
+    cell.velocity_ms = record.get(GateField::Velocity);
+    cell.spectrum_width = record.get(GateField::SpectrumWidth);
+    if (record.has(GateField::Phenomenon)) {
+        cell.phenomenon_type = std::to_string(static_cast<int>(record.get(GateField::Phenomenon)));
+    }
+    cell.observation = RadarObservation{
+        .azimuth_deg = record.get(GateField::Azimuth),
+        .range_km = record.get(GateField::Range),
+        .elevation_deg = record.get(GateField::Elevation),
+    };
+    cell.echo_top_km = echo_tops_.value(cell.row, cell.column);
+    return true;
+}
+
+bool CellAssembler::accepts(const CellData& cell) const {
+    if (!options_.allowed_phenomena.empty() &&
+        std::find(options_.allowed_phenomena.begin(), options_.allowed_phenomena.end(), cell.phenomenon_type) ==
+            options_.allowed_phenomena.end()) {
+        return false;
+    }
+    // Compared in float, as CellGrid stores reflectivity and ClusterAnalyzer applies thresholds.
+    return static_cast<float>(cell.reflectivity_dbz) >= static_cast<float>(options_.min_reflectivity_dbz);
+}
+
+}  // namespace radar
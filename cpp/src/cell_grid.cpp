@@ -1,24 +1,176 @@
 #include "radar/cell_grid.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
 namespace radar {
 
-void CellGrid::add_cell(CellData cell) {
-    std::pair<int, int> key{cell.row, cell.column};
-    auto it = index_.find(key);
-    if (it == index_.end()) {
-        index_[key] = cells_.size();
-        cells_.push_back(std::move(cell));
+namespace {
+
+// The raster is used while it has at most this many slots per cell (plus a fixed allowance, so
+// small grids never go sparse); beyond that the hashed index is cheaper in memory.
+constexpr std::size_t kMaxSlotsPerCell = 16;
+constexpr std::size_t kDenseAllowance = 1 << 16;
+
+GridExtent expand(const GridExtent& extent, int row, int column) {
+    if (extent.rows == 0) {
+        return GridExtent{row, column, 1, 1};
+    }
+    const long long min_row = std::min<long long>(extent.min_row, row);
+    const long long min_column = std::min<long long>(extent.min_column, column);
+    const long long max_row = std::max<long long>(extent.min_row + extent.rows - 1LL, row);
+    const long long max_column = std::max<long long>(extent.min_column + extent.columns - 1LL, column);
+    if (max_row - min_row >= INT32_MAX || max_column - min_column >= INT32_MAX) {
+        throw std::runtime_error("Cell grid extent is too large");
+    }
+    return GridExtent{static_cast<int>(min_row), static_cast<int>(min_column), static_cast<int>(max_row - min_row + 1),
+                      static_cast<int>(max_column - min_column + 1)};
+}
+
+// Pads `extent` by a quarter of its size on every side so cells arriving in scan order do not
+// force a rebuild each time the grid grows by a row.
+GridExtent with_slack(const GridExtent& extent) {
+    const long long row_pad = extent.rows / 4 + 8;
+    const long long column_pad = extent.columns / 4 + 8;
+    const long long min_row = std::max<long long>(INT32_MIN, extent.min_row - row_pad);
+    const long long min_column = std::max<long long>(INT32_MIN, extent.min_column - column_pad);
+    const long long max_row = std::min<long long>(INT32_MAX, extent.min_row + extent.rows - 1LL + row_pad);
+    const long long max_column = std::min<long long>(INT32_MAX, extent.min_column + extent.columns - 1LL + column_pad);
+    return GridExtent{static_cast<int>(min_row), static_cast<int>(min_column),
+                      static_cast<int>(std::min<long long>(INT32_MAX, max_row - min_row + 1)),
+                      static_cast<int>(std::min<long long>(INT32_MAX, max_column - min_column + 1))};
+}
+
+bool fits_raster(const GridExtent& extent, std::size_t cells) {
+    return extent.area() <= kMaxSlotsPerCell * cells + kDenseAllowance;
+}
+
+}  // namespace
+
+void CellGrid::add_cell(const CellData& cell) {
+    auto existing = index_of(cell.row, cell.column);
+    if (existing != npos) {
+        store(existing, cell);
+        return;
+    }
+    if (size() >= kEmpty) {
+        throw std::runtime_error("Too many cells in grid");
+    }
+
+    const auto index = static_cast<std::uint32_t>(size());
+    rows_.push_back(cell.row);
+    columns_.push_back(cell.column);
+    reflectivity_dbz_.emplace_back();
+    velocity_ms_.emplace_back();
+    spectrum_width_.emplace_back();
+    echo_top_km_.emplace_back();
+    phenomenon_ids_.emplace_back();
+    azimuth_deg_.emplace_back();
+    range_km_.emplace_back();
+    elevation_deg_.emplace_back();
+    store(index, cell);
+    extent_ = expand(extent_, cell.row, cell.column);
+
+    if (sparse_) {
+        sparse_index_.emplace(sparse_key(cell.row, cell.column), index);
+        // Re-evaluate once the grid has doubled; it may have filled in enough for the raster.
+        if (size() >= 2 * sparse_checked_at_ && fits_raster(extent_, size())) {
+            rebuild_index();
+        }
+    } else if (raster_extent_.contains(cell.row, cell.column)) {
+        raster_[raster_slot(cell.row, cell.column)] = index;
     } else {
-        cells_[it->second] = std::move(cell);
+        rebuild_index();
     }
 }
 
-std::optional<CellData> CellGrid::find(int row, int column) const {
-    auto it = index_.find({row, column});
-    if (it == index_.end()) {
-        return std::nullopt;
+void CellGrid::reserve(std::size_t count) {
+    rows_.reserve(count);
+    columns_.reserve(count);
+    reflectivity_dbz_.reserve(count);
+    velocity_ms_.reserve(count);
+    spectrum_width_.reserve(count);
+    echo_top_km_.reserve(count);
+    phenomenon_ids_.reserve(count);
+    azimuth_deg_.reserve(count);
+    range_km_.reserve(count);
+    elevation_deg_.reserve(count);
+}
+
+CellData CellGrid::cell(std::size_t index) const {
+    CellData cell;
+    cell.row = rows_[index];
+    cell.column = columns_[index];
+    cell.reflectivity_dbz = reflectivity_dbz_[index];
+    cell.velocity_ms = velocity_ms_[index];
+    cell.spectrum_width = spectrum_width_[index];
+    cell.observation = observation(index);
+    if (!std::isnan(echo_top_km_[index])) {
+        cell.echo_top_km = echo_top_km_[index];
+    }
+    cell.phenomenon_type = phenomenon(index);
+    return cell;
+}
+
+void CellGrid::store(std::size_t index, const CellData& cell) {
+    reflectivity_dbz_[index] = static_cast<float>(cell.reflectivity_dbz);
+    velocity_ms_[index] = static_cast<float>(cell.velocity_ms);
+    spectrum_width_[index] = static_cast<float>(cell.spectrum_width);
+    echo_top_km_[index] = cell.echo_top_km.has_value() ? static_cast<float>(cell.echo_top_km.value())
+                                                         : std::numeric_limits<float>::quiet_NaN();
+    phenomenon_ids_[index] = intern(cell.phenomenon_type);
+    azimuth_deg_[index] = static_cast<float>(cell.observation.azimuth_deg);
+    range_km_[index] = static_cast<float>(cell.observation.range_km);
+    elevation_deg_[index] = static_cast<float>(cell.observation.elevation_deg);
+}
+
+std::uint16_t CellGrid::intern(const std::string& phenomenon) {
+    // Volumes carry a handful of codes, so the last one almost always matches.
+    if (!phenomena_.empty() && phenomena_[last_phenomenon_] == phenomenon) {
+        return last_phenomenon_;
+    }
+    auto it = phenomenon_lookup_.find(phenomenon);
+    if (it == phenomenon_lookup_.end()) {
+        if (phenomena_.size() > UINT16_MAX) {
+            throw std::runtime_error("Too many distinct phenomenon codes");
+        }
+        it = phenomenon_lookup_.emplace(phenomenon, static_cast<std::uint16_t>(phenomena_.size())).first;
+        phenomena_.push_back(phenomenon);
+    }
+    last_phenomenon_ = it->second;
+    return it->second;
+}
+
+std::size_t CellGrid::sparse_index_of(int row, int column) const {
+    auto it = sparse_index_.find(sparse_key(row, column));
+    return it == sparse_index_.end() ? npos : it->second;
+}
+
+void CellGrid::rebuild_index() {
+    raster_.clear();
+    sparse_index_.clear();
+    raster_extent_ = GridExtent{};
+    sparse_ = !fits_raster(extent_, size());
+    if (sparse_) {
+        sparse_checked_at_ = size();
+        raster_.shrink_to_fit();
+        sparse_index_.reserve(size());
+        for (std::size_t i = 0; i < size(); ++i) {
+            sparse_index_.emplace(sparse_key(rows_[i], columns_[i]), static_cast<std::uint32_t>(i));
+        }
+        return;
+    }
+
+    raster_extent_ = with_slack(extent_);
+    if (!fits_raster(raster_extent_, size())) {
+        raster_extent_ = extent_;
+    }
+    raster_.assign(raster_extent_.area(), kEmpty);
+    for (std::size_t i = 0; i < size(); ++i) {
+        raster_[raster_slot(rows_[i], columns_[i])] = static_cast<std::uint32_t>(i);
     }
-    return cells_[it->second];
 }
 
 }  // namespace radar
@@ -1,76 +1,431 @@
 #include "radar/cluster_analyzer.h"
 
 #include <algorithm>
-#include <queue>
+#include <cmath>
+
+#include "radar/parallel.h"
 
 namespace radar {
 
-ClusterAnalyzer::ClusterAnalyzer(const CellGrid& grid) : grid_(grid) {}
+namespace {
+
+// Rows per band are chosen so every worker gets a few bands to balance uneven storm cover.
+constexpr std::size_t kBandsPerThread = 4;
+constexpr std::size_t kMinBandRows = 16;
+constexpr std::size_t kCellsPerBlock = 1 << 14;
+
+// Union-find over labels stored in a caller-owned array. Roots are always the smallest label of
+// their set, so parent[x] <= x holds throughout.
+class LabelForest {
+public:
+    explicit LabelForest(std::uint32_t* parent) : parent_(parent) {}
 
-std::vector<Cluster> ClusterAnalyzer::find_clusters(double reflectivity_threshold_dbz) const {
-    std::set<std::pair<int, int>> visited;
-    std::vector<Cluster> clusters;
+    void make(std::uint32_t label) { parent_[label] = label; }
+
+    std::uint32_t find(std::uint32_t label) {
+        while (parent_[label] != label) {
+            parent_[label] = parent_[parent_[label]];  // path halving
+            label = parent_[label];
+        }
+        return label;
+    }
 
-    for (const auto& cell : grid_.cells()) {
-        if (cell.reflectivity_dbz < reflectivity_threshold_dbz) {
+    // Read-only find, safe to run concurrently once no more unions happen.
+    std::uint32_t root(std::uint32_t label) const {
+        while (parent_[label] != label) {
+            label = parent_[label];
+        }
+        return label;
+    }
+
+    std::uint32_t unite(std::uint32_t a, std::uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return a;
+        }
+        if (b < a) {
+            std::swap(a, b);
+        }
+        parent_[b] = a;
+        return a;
+    }
+
+private:
+    std::uint32_t* parent_;
+};
+
+// BFS semantics: a NaN reflectivity is not below the threshold. Thresholds are rounded to float
+// first: a 35.3 dBZ gate is stored as float(35.3), which is below the double 35.3.
+bool above(float reflectivity, float threshold) { return !(reflectivity < threshold); }
+
+// Running sums behind the averaged cluster statistics.
+struct ClusterSums {
+    double reflectivity = 0.0;
+    std::size_t reflectivity_count = 0;
+    double latitude = 0.0;  // cell centres weighted by area
+    double longitude = 0.0;
+};
+
+// Fills `set` from dense cluster numbers (kUnlabelled for cells outside every cluster): members
+// are grouped by cluster with a counting sort and the statistics accumulate as they are placed.
+void gather(const CellGrid& grid, const std::vector<std::uint32_t>& labels, ClusterSet& set) {
+    auto& clusters = set.clusters;
+    clusters.clear();
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+        if (labels[i] == ClusterAnalyzer::kUnlabelled) {
             continue;
         }
-        auto key = std::make_pair(cell.row, cell.column);
-        if (visited.count(key)) {
+        if (labels[i] == clusters.size()) {
+            auto& cluster = clusters.emplace_back();
+            cluster.seed = static_cast<std::uint32_t>(i);
+            cluster.bounds = GeoBounds{std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+                                       std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+        }
+        ++clusters[labels[i]].cell_count;
+    }
+    std::uint32_t offset = 0;
+    for (auto& cluster : clusters) {
+        cluster.first_member = offset;
+        offset += cluster.cell_count;
+    }
+
+    const auto reflectivity = grid.reflectivity_dbz();
+    const auto velocity = grid.velocity_ms();
+    const auto echo_top = grid.echo_top_km();
+    std::vector<ClusterSums> sums(clusters.size());
+    std::vector<std::uint32_t> cursor(clusters.size());
+    for (std::size_t c = 0; c < clusters.size(); ++c) {
+        cursor[c] = clusters[c].first_member;
+    }
+    set.members.resize(offset);
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+        if (labels[i] == ClusterAnalyzer::kUnlabelled) {
             continue;
         }
-        Cluster cluster;
-        visit(cell.row, cell.column, reflectivity_threshold_dbz, visited, cluster);
-        if (!cluster.cells.empty()) {
-            clusters.push_back(std::move(cluster));
+        auto& cluster = clusters[labels[i]];
+        auto& sum = sums[labels[i]];
+        set.members[cursor[labels[i]]++] = static_cast<std::uint32_t>(i);
+
+        const double dbz = reflectivity[i];
+        cluster.max_reflectivity = std::max(cluster.max_reflectivity, dbz);
+        if (!std::isnan(dbz)) {
+            sum.reflectivity += dbz;
+            ++sum.reflectivity_count;
+        }
+        if (!std::isnan(echo_top[i])) {
+            cluster.max_echo_top_km = std::max(cluster.max_echo_top_km.value_or(0.0), static_cast<double>(echo_top[i]));
+        }
+        cluster.min_velocity_ms = std::fmin(cluster.min_velocity_ms, velocity[i]);
+        cluster.max_velocity_ms = std::fmax(cluster.max_velocity_ms, velocity[i]);
+
+        const auto cell = grid.geometry(i);
+        const double area = cell_area_km2(cell);
+        cluster.area_km2 += area;
+        sum.latitude += cell.center.latitude_deg * area;
+        sum.longitude += cell.center.longitude_deg * area;
+        for (const auto& vertex : cell.vertices) {
+            cluster.bounds.min_latitude_deg = std::min(cluster.bounds.min_latitude_deg, vertex.latitude_deg);
+            cluster.bounds.max_latitude_deg = std::max(cluster.bounds.max_latitude_deg, vertex.latitude_deg);
+            cluster.bounds.min_longitude_deg = std::min(cluster.bounds.min_longitude_deg, vertex.longitude_deg);
+            cluster.bounds.max_longitude_deg = std::max(cluster.bounds.max_longitude_deg, vertex.longitude_deg);
+        }
+    }
+
+    for (std::size_t c = 0; c < clusters.size(); ++c) {
+        auto& cluster = clusters[c];
+        const auto& sum = sums[c];
+        if (sum.reflectivity_count > 0) {
+            cluster.mean_reflectivity_dbz = sum.reflectivity / static_cast<double>(sum.reflectivity_count);
+        }
+        if (cluster.area_km2 > 0.0) {
+            cluster.centroid = GeoCoordinate{sum.latitude / cluster.area_km2, sum.longitude / cluster.area_km2};
+        } else {
+            cluster.centroid = grid.center(cluster.seed);
         }
     }
-    return clusters;
 }
 
-void ClusterAnalyzer::visit(int row, int column, double threshold, std::set<std::pair<int, int>>& visited, Cluster& cluster) const {
-    std::queue<std::pair<int, int>> queue;
-    queue.emplace(row, column);
-    visited.insert({row, column});
+}  // namespace
+
+ClusterAnalyzer::ClusterAnalyzer(const CellGrid& grid, ClusterOptions options) : grid_(grid), options_(options) {}
+
+ClusterSet ClusterAnalyzer::find_clusters(double reflectivity_threshold_dbz) const {
+    ClusterSet set;
+    set.threshold_dbz = reflectivity_threshold_dbz;
+    gather(grid_, label_cells(reflectivity_threshold_dbz), set);
+    return set;
+}
+
+ClusterTree ClusterAnalyzer::build_cluster_tree(std::vector<double> thresholds_dbz) const {
+    std::sort(thresholds_dbz.begin(), thresholds_dbz.end());
+    thresholds_dbz.erase(std::unique(thresholds_dbz.begin(), thresholds_dbz.end()), thresholds_dbz.end());
+    const std::size_t level_count = thresholds_dbz.size();
+    ClusterTree tree(level_count);
+    if (level_count == 0) {
+        return tree;
+    }
+    if (level_count == 1) {
+        // Nothing to nest; the banded labelling is the faster single pass.
+        static_cast<ClusterSet&>(tree[0]) = find_clusters(thresholds_dbz[0]);
+        tree[0].parents.assign(tree[0].clusters.size(), ClusterLevel::kNoParent);
+        tree[0].child_offsets.assign(tree[0].clusters.size() + 1, 0);
+        return tree;
+    }
+
+    // Highest level each cell reaches, -1 below every threshold; compared in float as in above().
+    const auto reflectivity = grid_.reflectivity_dbz();
+    const std::vector<float> cuts(thresholds_dbz.begin(), thresholds_dbz.end());
+    std::vector<int> top_level(grid_.size());
+    std::vector<std::size_t> level_sizes(level_count, 0);
+    for (std::size_t i = 0; i < grid_.size(); ++i) {
+        std::size_t reached =
+            std::isnan(reflectivity[i])
+                ? level_count
+                : static_cast<std::size_t>(std::upper_bound(cuts.begin(), cuts.end(), reflectivity[i]) - cuts.begin());
+        top_level[i] = static_cast<int>(reached) - 1;
+        if (reached > 0) {
+            ++level_sizes[reached - 1];
+        }
+    }
+    // Cells bucketed by top level, insertion order within a bucket.
+    std::vector<std::size_t> bucket_offsets(level_count + 1, 0);
+    for (std::size_t level = 0; level < level_count; ++level) {
+        bucket_offsets[level + 1] = bucket_offsets[level] + level_sizes[level];
+    }
+    std::vector<std::uint32_t> buckets(bucket_offsets.back());
+    {
+        auto cursor = bucket_offsets;
+        for (std::size_t i = 0; i < grid_.size(); ++i) {
+            if (top_level[i] >= 0) {
+                buckets[cursor[static_cast<std::size_t>(top_level[i])]++] = static_cast<std::uint32_t>(i);
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> parent(grid_.size());
+    LabelForest forest(parent.data());
+    const auto rows = grid_.rows();
+    const auto columns = grid_.columns();
+    // Cluster of each cell and of each root on the level being extracted; roots are stamped with
+    // their level so entries left over from the level above are ignored.
+    std::vector<std::uint32_t> cell_cluster(grid_.size());
+    std::vector<std::uint32_t> root_cluster(grid_.size());
+    std::vector<int> root_level(grid_.size(), -1);
 
-    while (!queue.empty()) {
-        auto [current_row, current_column] = queue.front();
-        queue.pop();
+    for (std::size_t level = level_count; level-- > 0;) {
+        const int current = static_cast<int>(level);
+        for (std::size_t b = bucket_offsets[level]; b < bucket_offsets[level + 1]; ++b) {
+            forest.make(buckets[b]);
+        }
+        // Join the cells entering at this level to every neighbour already present.
+        for (std::size_t b = bucket_offsets[level]; b < bucket_offsets[level + 1]; ++b) {
+            const auto i = buckets[b];
+            for (int dr = -1; dr <= 1; ++dr) {
+                for (int dc = -1; dc <= 1; ++dc) {
+                    if (dr == 0 && dc == 0) {
+                        continue;
+                    }
+                    auto j = grid_.index_of(rows[i] + dr, columns[i] + dc);
+                    if (j != CellGrid::npos && top_level[j] >= current) {
+                        forest.unite(i, static_cast<std::uint32_t>(j));
+                    }
+                }
+            }
+        }
 
-        auto cell_opt = grid_.find(current_row, current_column);
-        if (!cell_opt.has_value()) {
+        std::uint32_t clusters = 0;
+        for (std::size_t i = 0; i < grid_.size(); ++i) {
+            if (top_level[i] < current) {
+                cell_cluster[i] = kUnlabelled;
+                continue;
+            }
+            auto root = forest.find(static_cast<std::uint32_t>(i));
+            if (root_level[root] != current) {
+                root_level[root] = current;
+                root_cluster[root] = clusters++;
+            }
+            cell_cluster[i] = root_cluster[root];
+        }
+
+        auto& out = tree[level];
+        out.threshold_dbz = thresholds_dbz[level];
+        gather(grid_, cell_cluster, out);
+        out.parents.assign(out.clusters.size(), ClusterLevel::kNoParent);
+        if (level + 1 < level_count) {
+            auto& above = tree[level + 1];
+            for (std::size_t c = 0; c < above.clusters.size(); ++c) {
+                above.parents[c] = cell_cluster[above.clusters[c].seed];
+            }
+        }
+    }
+
+    for (std::size_t level = 0; level < level_count; ++level) {
+        auto& out = tree[level];
+        out.child_offsets.assign(out.clusters.size() + 1, 0);
+        if (level + 1 == level_count) {
             continue;
         }
-        auto cell = cell_opt.value();
-        if (cell.reflectivity_dbz < threshold) {
+        const auto& above = tree[level + 1];
+        for (auto parent_id : above.parents) {
+            ++out.child_offsets[parent_id + 1];
+        }
+        for (std::size_t c = 0; c < out.clusters.size(); ++c) {
+            out.child_offsets[c + 1] += out.child_offsets[c];
+        }
+        out.child_ids.resize(above.parents.size());
+        auto cursor = out.child_offsets;
+        for (std::size_t child = 0; child < above.parents.size(); ++child) {
+            out.child_ids[cursor[above.parents[child]]++] = static_cast<std::uint32_t>(child);
+        }
+    }
+    return tree;
+}
+
+std::vector<std::uint32_t> ClusterAnalyzer::label_cells(double reflectivity_threshold_dbz) const {
+    if (grid_.empty()) {
+        return {};
+    }
+    const auto threshold = static_cast<float>(reflectivity_threshold_dbz);
+    auto labels = grid_.is_dense() ? label_raster(threshold) : label_sparse(threshold);
+
+    // Renumber roots by first cell in insertion order, the order the BFS used to seed clusters.
+    // Roots are bounded by the label space, so a flat table maps them.
+    std::uint32_t max_root = 0;
+    for (auto label : labels) {
+        if (label != kUnlabelled) {
+            max_root = std::max(max_root, label);
+        }
+    }
+    std::vector<std::uint32_t> cluster_of_root(static_cast<std::size_t>(max_root) + 1, kUnlabelled);
+    std::uint32_t clusters = 0;
+    for (auto& label : labels) {
+        if (label == kUnlabelled) {
             continue;
         }
-        cluster.max_reflectivity = std::max(cluster.max_reflectivity, cell.reflectivity_dbz);
-        if (cell.echo_top_km.has_value()) {
-            cluster.max_echo_top_km = std::max(cluster.max_echo_top_km.value_or(0.0), cell.echo_top_km.value());
+        auto& cluster = cluster_of_root[label];
+        if (cluster == kUnlabelled) {
+            cluster = clusters++;
         }
-        cluster.cells.push_back(cell);
+        label = cluster;
+    }
+    return labels;
+}
+
+// Two-pass scan-line labelling over the grid extent, run on row bands in parallel. Within a
+// band, each qualifying slot takes the label of its already-visited neighbours (W, NW, N, NE)
+// and disagreements are recorded as unions. Labels are slot numbers plus one, so every band
+// draws from its own range and shares one parent array without locking. Bands are then
+// stitched by uniting labels across each band's first row, and every cell resolves its label
+// to the set's root.
+std::vector<std::uint32_t> ClusterAnalyzer::label_raster(float threshold) const {
+    const auto& extent = grid_.extent();
+    const auto columns = static_cast<std::size_t>(extent.columns);
+    const auto rows = static_cast<std::size_t>(extent.rows);
+    const auto reflectivity = grid_.reflectivity_dbz();
+    const std::size_t threads = resolve_thread_count(options_.threads);
+    const std::size_t band_rows =
+        threads <= 1 ? rows : std::max(kMinBandRows, (rows + threads * kBandsPerThread - 1) / (threads * kBandsPerThread));
+
+    // Provisional labels; 0 marks background.
+    std::vector<std::uint32_t> raster(extent.area(), 0);
+    std::vector<std::uint32_t> parent(extent.area() + 1);
+    LabelForest forest(parent.data());
 
-        for (const auto& neighbor : neighbors(current_row, current_column)) {
-            if (!visited.count(neighbor)) {
-                visited.insert(neighbor);
-                queue.push(neighbor);
+    parallel_for(rows, threads, band_rows, [&](std::size_t first_row, std::size_t end_row) {
+        for (std::size_t r = first_row; r < end_row; ++r) {
+            std::uint32_t* row = raster.data() + r * columns;
+            const std::uint32_t* previous = r > first_row ? row - columns : nullptr;
+            for (std::size_t c = 0; c < columns; ++c) {
+                auto index = grid_.index_of(extent.min_row + static_cast<int>(r), extent.min_column + static_cast<int>(c));
+                if (index == CellGrid::npos || !above(reflectivity[index], threshold)) {
+                    continue;
+                }
+                std::uint32_t label = c > 0 ? row[c - 1] : 0;
+                if (previous != nullptr) {
+                    const std::uint32_t neighbours[3] = {c > 0 ? previous[c - 1] : 0u, previous[c],
+                                                         c + 1 < columns ? previous[c + 1] : 0u};
+                    for (auto neighbour : neighbours) {
+                        if (neighbour != 0) {
+                            label = label == 0 ? neighbour : forest.unite(label, neighbour);
+                        }
+                    }
+                }
+                if (label == 0) {
+                    label = static_cast<std::uint32_t>(r * columns + c + 1);
+                    forest.make(label);
+                }
+                row[c] = label;
+            }
+        }
+    });
+
+    // parallel_for splits rows into blocks of band_rows, so bands start at multiples of it.
+    for (std::size_t r = band_rows; r < rows; r += band_rows) {
+        const std::uint32_t* row = raster.data() + r * columns;
+        const std::uint32_t* previous = row - columns;
+        for (std::size_t c = 0; c < columns; ++c) {
+            if (row[c] == 0) {
+                continue;
+            }
+            for (std::size_t n = c > 0 ? c - 1 : 0; n <= std::min(c + 1, columns - 1); ++n) {
+                if (previous[n] != 0) {
+                    forest.unite(row[c], previous[n]);
+                }
             }
         }
     }
+
+    std::vector<std::uint32_t> labels(grid_.size(), kUnlabelled);
+    const auto cell_rows = grid_.rows();
+    const auto cell_columns = grid_.columns();
+    parallel_for(labels.size(), threads, kCellsPerBlock, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            auto slot = static_cast<std::size_t>(cell_rows[i] - extent.min_row) * columns +
+                        static_cast<std::size_t>(cell_columns[i] - extent.min_column);
+            if (raster[slot] != 0) {
+                labels[i] = forest.root(raster[slot]);
+            }
+        }
+    });
+    return labels;
 }
 
-std::vector<std::pair<int, int>> ClusterAnalyzer::neighbors(int row, int column) const {
-    std::vector<std::pair<int, int>> result;
-    for (int dr = -1; dr <= 1; ++dr) {
-        for (int dc = -1; dc <= 1; ++dc) {
-            if (dr == 0 && dc == 0) {
-                continue;
+// Grids too sparse for a raster: union each qualifying cell with its qualifying neighbours
+// through the grid's hashed index.
+std::vector<std::uint32_t> ClusterAnalyzer::label_sparse(float threshold) const {
+    const auto reflectivity = grid_.reflectivity_dbz();
+    const auto rows = grid_.rows();
+    const auto columns = grid_.columns();
+    std::vector<std::uint32_t> parent(grid_.size());
+    LabelForest forest(parent.data());
+    for (std::size_t i = 0; i < grid_.size(); ++i) {
+        forest.make(static_cast<std::uint32_t>(i));
+    }
+    for (std::size_t i = 0; i < grid_.size(); ++i) {
+        if (!above(reflectivity[i], threshold)) {
+            continue;
+        }
+        for (int dr = -1; dr <= 0; ++dr) {
+            for (int dc = -1; dc <= 1; ++dc) {
+                if (dr == 0 && dc >= 0) {
+                    break;
+                }
+                auto j = grid_.index_of(rows[i] + dr, columns[i] + dc);
+                if (j != CellGrid::npos && above(reflectivity[j], threshold)) {
+                    forest.unite(static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(j));
+                }
             }
-            result.emplace_back(row + dr, column + dc);
         }
     }
-    return result;
+
+    std::vector<std::uint32_t> labels(grid_.size(), kUnlabelled);
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+        if (above(reflectivity[i], threshold)) {
+            labels[i] = forest.find(static_cast<std::uint32_t>(i));
+        }
+    }
+    return labels;
 }
 
 }  // namespace radar
@@ -1,5 +1,6 @@
 #include "radar/config.h"
 
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -19,6 +20,9 @@ PipelineConfig from_json(const JsonValue& j) {
         config.image_output_path = image->as_string();
     }
     config.tables_path = j.at("tables_path").as_string();
+    if (const auto* sequences = json_try_get(j, "sequence_tables_path")) {
+        config.sequence_tables_path = sequences->as_string();
+    }
     if (const auto* lat = json_try_get(j, "radar_latitude")) {
         config.radar_latitude = lat->as_number();
     }
@@ -37,6 +41,90 @@ PipelineConfig from_json(const JsonValue& j) {
     if (const auto* image_height = json_try_get(j, "image_height")) {
         config.image_height = static_cast<std::size_t>(image_height->as_number());
     }
+    if (const auto* format = json_try_get(j, "image_format")) {
+        const auto& name = format->as_string();
+        if (name == "bmp") {
+            config.image_format = ImageFormat::Bmp;
+        } else if (name == "png") {
+            config.image_format = ImageFormat::Png;
+        } else {
+            throw std::runtime_error("Unknown image_format: " + name);
+        }
+    }
+    if (const auto* palette = json_try_get(j, "image_palette")) {
+        config.image_palette = palette->as_bool();
+    }
+    if (const auto* reflectivity = json_try_get(j, "reflectivity_image_path")) {
+        config.reflectivity_image_path = reflectivity->as_string();
+    }
+    if (const auto* range = json_try_get(j, "reflectivity_max_range_km")) {
+        config.reflectivity_max_range_km = range->as_number();
+    }
+    if (const auto* tiles = json_try_get(j, "tile_output_dir")) {
+        config.tile_output_dir = tiles->as_string();
+    }
+    if (const auto* min_zoom = json_try_get(j, "tile_min_zoom")) {
+        config.tile_min_zoom = static_cast<int>(min_zoom->as_number());
+    }
+    if (const auto* max_zoom = json_try_get(j, "tile_max_zoom")) {
+        config.tile_max_zoom = static_cast<int>(max_zoom->as_number());
+    }
+    if (const auto* decode_threads = json_try_get(j, "decode_threads")) {
+        config.decode_threads = static_cast<std::size_t>(decode_threads->as_number());
+    }
+    if (const auto* cluster_threads = json_try_get(j, "cluster_threads")) {
+        config.cluster_threads = static_cast<std::size_t>(cluster_threads->as_number());
+    }
+    if (const auto* render_threads = json_try_get(j, "render_threads")) {
+        config.render_threads = static_cast<std::size_t>(render_threads->as_number());
+    }
+    if (const auto* layout = json_try_get(j, "bufr_layout")) {
+        const auto& name = layout->as_string();
+        if (name == "compact") {
+            config.bufr_layout = BufrLayout::Compact;
+        } else if (name == "wmo") {
+            config.bufr_layout = BufrLayout::Wmo;
+        } else {
+            throw std::runtime_error("Unknown bufr_layout: " + name);
+        }
+    }
+    if (const auto* mode = json_try_get(j, "contour_mode")) {
+        const auto& name = mode->as_string();
+        if (name == "hull") {
+            config.contour_mode = ContourMode::Hull;
+        } else if (name == "outline") {
+            config.contour_mode = ContourMode::Outline;
+        } else {
+            throw std::runtime_error("Unknown contour_mode: " + name);
+        }
+    }
+    if (const auto* tolerance = json_try_get(j, "simplify_tolerance_km")) {
+        config.simplify_tolerance_km = tolerance->as_number();
+    }
+    if (const auto* format = json_try_get(j, "contour_output_format")) {
+        const auto& name = format->as_string();
+        if (name == "geojson") {
+            config.contour_output_format = ContourOutputFormat::GeoJson;
+        } else if (name == "binary") {
+            config.contour_output_format = ContourOutputFormat::Binary;
+        } else if (name == "both") {
+            config.contour_output_format = ContourOutputFormat::Both;
+        } else {
+            throw std::runtime_error("Unknown contour_output_format: " + name);
+        }
+    }
+    if (const auto* binary = json_try_get(j, "merged_binary_output")) {
+        config.merged_binary_output = binary->as_string();
+    } else {
+        config.merged_binary_output =
+            std::filesystem::path(config.merged_geojson_output).replace_extension(".rhcf").string();
+    }
+    if (const auto* precision = json_try_get(j, "geojson_precision")) {
+        config.geojson_precision = static_cast<int>(precision->as_number());
+    }
+    if (const auto* compact = json_try_get(j, "geojson_compact")) {
+        config.geojson_compact = compact->as_bool();
+    }
     if (const auto* thresholds = json_try_get(j, "reflectivity_thresholds")) {
         for (const auto& value : thresholds->as_array()) {
             config.reflectivity_thresholds.push_back(value.as_number());
@@ -71,7 +159,9 @@ PipelineConfig ConfigLoader::load_pipeline(const std::string& path) {
     }
     std::ostringstream buffer;
     buffer << stream.rdbuf();
-    JsonParser parser(buffer.str());
+    // JsonParser keeps a reference to its input, so the text must outlive it.
+    const std::string text = buffer.str();
+    JsonParser parser(text);
     return from_json(parser.parse());
 }
 
@@ -82,7 +172,9 @@ std::unordered_map<std::string, DescriptorDefinition> ConfigLoader::load_tables(
     }
     std::ostringstream buffer;
     buffer << stream.rdbuf();
-    JsonParser parser(buffer.str());
+    // JsonParser keeps a reference to its input, so the text must outlive it.
+    const std::string text = buffer.str();
+    JsonParser parser(text);
     auto root = parser.parse();
     std::unordered_map<std::string, DescriptorDefinition> tables;
     for (const auto& [key, value] : root.as_object()) {
@@ -91,4 +183,24 @@ std::unordered_map<std::string, DescriptorDefinition> ConfigLoader::load_tables(
     return tables;
 }
 
+std::unordered_map<std::string, std::vector<std::string>> ConfigLoader::load_sequences(const std::string& path) {
+    std::ifstream stream(path);
+    if (!stream.is_open()) {
+        throw std::runtime_error("Cannot open sequence tables: " + path);
+    }
+    std::ostringstream buffer;
+    buffer << stream.rdbuf();
+    const std::string text = buffer.str();
+    JsonParser parser(text);
+    auto root = parser.parse();
+    std::unordered_map<std::string, std::vector<std::string>> sequences;
+    for (const auto& [key, value] : root.as_object()) {
+        auto& members = sequences[key];
+        for (const auto& member : value.as_array()) {
+            members.push_back(member.as_string());
+        }
+    }
+    return sequences;
+}
+
 }  // namespace radar
@@ -0,0 +1,280 @@
+#include "radar/contour_file.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace radar {
+namespace {
+
+constexpr char kMagic[4] = {'R', 'H', 'C', 'F'};
+constexpr std::uint16_t kVersion = 1;
+constexpr std::size_t kHeaderSize = 48;
+constexpr std::size_t kEntrySize = 48;
+constexpr std::size_t kPhenomenonSize = 16;
+constexpr std::size_t kPropertiesSize = kPhenomenonSize + 3 * sizeof(double);
+constexpr std::uint8_t kWkbLittleEndian = 1;
+constexpr std::uint32_t kWkbPolygon = 3;
+
+// Bytes are placed explicitly so the file is little-endian whatever the host.
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<std::uint8_t>& out) : out_(out) {}
+
+    void u8(std::uint8_t value) { out_.push_back(value); }
+    void u16(std::uint16_t value) { put(value, 2); }
+    void u32(std::uint32_t value) { put(value, 4); }
+    void u64(std::uint64_t value) { put(value, 8); }
+    void f64(double value) { put(std::bit_cast<std::uint64_t>(value), 8); }
+    void bytes(const char* data, std::size_t count) { out_.insert(out_.end(), data, data + count); }
+    void pad_to(std::size_t alignment) { out_.resize((out_.size() + alignment - 1) / alignment * alignment, 0); }
+
+private:
+    void put(std::uint64_t value, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            out_.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    std::vector<std::uint8_t>& out_;
+};
+
+class ByteReader {
+public:
+    explicit ByteReader(std::span<const std::uint8_t> data) : data_(data) {}
+
+    std::uint8_t u8() { return static_cast<std::uint8_t>(get(1)); }
+    std::uint16_t u16() { return static_cast<std::uint16_t>(get(2)); }
+    std::uint32_t u32() { return static_cast<std::uint32_t>(get(4)); }
+    std::uint64_t u64() { return get(8); }
+    double f64() { return std::bit_cast<double>(get(8)); }
+    std::span<const std::uint8_t> bytes(std::size_t count) {
+        require(count);
+        auto result = data_.subspan(offset_, count);
+        offset_ += count;
+        return result;
+    }
+    std::size_t remaining() const { return data_.size() - offset_; }
+
+private:
+    void require(std::size_t count) const {
+        if (count > remaining()) {
+            throw std::runtime_error("Truncated contour file");
+        }
+    }
+    std::uint64_t get(std::size_t count) {
+        require(count);
+        std::uint64_t value = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            value |= static_cast<std::uint64_t>(data_[offset_ + i]) << (8 * i);
+        }
+        offset_ += count;
+        return value;
+    }
+
+    std::span<const std::uint8_t> data_;
+    std::size_t offset_ = 0;
+};
+
+void extend(GeoBounds& bounds, const std::vector<GeoCoordinate>& ring) {
+    for (const auto& point : ring) {
+        bounds.min_latitude_deg = std::min(bounds.min_latitude_deg, point.latitude_deg);
+        bounds.max_latitude_deg = std::max(bounds.max_latitude_deg, point.latitude_deg);
+        bounds.min_longitude_deg = std::min(bounds.min_longitude_deg, point.longitude_deg);
+        bounds.max_longitude_deg = std::max(bounds.max_longitude_deg, point.longitude_deg);
+    }
+}
+
+// Closed boxes, so bounds that only touch still intersect.
+bool intersects(const GeoBounds& a, const GeoBounds& b) {
+    return a.min_latitude_deg <= b.max_latitude_deg && b.min_latitude_deg <= a.max_latitude_deg &&
+           a.min_longitude_deg <= b.max_longitude_deg && b.min_longitude_deg <= a.max_longitude_deg;
+}
+
+void write_bounds(ByteWriter& out, const GeoBounds& bounds) {
+    out.f64(bounds.min_longitude_deg);
+    out.f64(bounds.min_latitude_deg);
+    out.f64(bounds.max_longitude_deg);
+    out.f64(bounds.max_latitude_deg);
+}
+
+GeoBounds read_bounds(ByteReader& in) {
+    GeoBounds bounds;
+    bounds.min_longitude_deg = in.f64();
+    bounds.min_latitude_deg = in.f64();
+    bounds.max_longitude_deg = in.f64();
+    bounds.max_latitude_deg = in.f64();
+    return bounds;
+}
+
+void write_ring(ByteWriter& out, const std::vector<GeoCoordinate>& ring) {
+    out.u32(static_cast<std::uint32_t>(ring.size()));
+    for (const auto& point : ring) {
+        out.f64(point.longitude_deg);
+        out.f64(point.latitude_deg);
+    }
+}
+
+std::vector<GeoCoordinate> read_ring(ByteReader& in) {
+    std::uint32_t count = in.u32();
+    if (count > in.remaining() / (2 * sizeof(double))) {
+        throw std::runtime_error("Truncated contour file");
+    }
+    std::vector<GeoCoordinate> ring(count);
+    for (auto& point : ring) {
+        point.longitude_deg = in.f64();
+        point.latitude_deg = in.f64();
+    }
+    return ring;
+}
+
+}  // namespace
+
+void ContourFileWriter::write(const std::vector<MergedContour>& contours, const std::filesystem::path& path) {
+    if (contours.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Too many contours for a contour file");
+    }
+
+    // Records are laid out first so the index can carry their offsets.
+    const std::size_t data_offset = kHeaderSize + contours.size() * kEntrySize;
+    std::vector<std::uint8_t> records;
+    std::vector<ContourFileEntry> entries;
+    entries.reserve(contours.size());
+    const GeoBounds empty{std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+                          std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+    GeoBounds extent = contours.empty() ? GeoBounds{} : empty;
+    ByteWriter out(records);
+    for (const auto& contour : contours) {
+        if (contour.phenomenon_type.size() >= kPhenomenonSize) {
+            throw std::runtime_error("Phenomenon code too long for a contour file: " + contour.phenomenon_type);
+        }
+        ContourFileEntry entry;
+        entry.bounds = empty;
+        entry.offset = data_offset + records.size();
+
+        char phenomenon[kPhenomenonSize] = {};
+        std::memcpy(phenomenon, contour.phenomenon_type.data(), contour.phenomenon_type.size());
+        out.bytes(phenomenon, kPhenomenonSize);
+        out.f64(contour.threshold_dbz);
+        out.f64(contour.max_reflectivity);
+        out.f64(contour.max_echo_top_km.value_or(std::numeric_limits<double>::quiet_NaN()));
+
+        const auto& polygon = contour.geometry;
+        out.u8(kWkbLittleEndian);
+        out.u32(kWkbPolygon);
+        out.u32(static_cast<std::uint32_t>(1 + polygon.holes.size()));
+        write_ring(out, polygon.vertices);
+        for (const auto& hole : polygon.holes) {
+            write_ring(out, hole);
+        }
+        entry.size = data_offset + records.size() - entry.offset;
+        out.pad_to(8);
+
+        extend(entry.bounds, polygon.vertices);  // holes lie inside the outer ring
+        extent.min_latitude_deg = std::min(extent.min_latitude_deg, entry.bounds.min_latitude_deg);
+        extent.max_latitude_deg = std::max(extent.max_latitude_deg, entry.bounds.max_latitude_deg);
+        extent.min_longitude_deg = std::min(extent.min_longitude_deg, entry.bounds.min_longitude_deg);
+        extent.max_longitude_deg = std::max(extent.max_longitude_deg, entry.bounds.max_longitude_deg);
+        entries.push_back(entry);
+    }
+
+    std::vector<std::uint8_t> head;
+    head.reserve(data_offset);
+    ByteWriter header(head);
+    for (char c : kMagic) {
+        header.u8(static_cast<std::uint8_t>(c));
+    }
+    header.u16(kVersion);
+    header.u16(0);
+    header.u32(static_cast<std::uint32_t>(contours.size()));
+    header.u32(0);
+    write_bounds(header, extent);
+    for (const auto& entry : entries) {
+        write_bounds(header, entry.bounds);
+        header.u64(entry.offset);
+        header.u64(entry.size);
+    }
+
+    std::ofstream stream(path, std::ios::binary);
+    if (!stream.is_open()) {
+        throw std::runtime_error("Cannot open contour output: " + path.string());
+    }
+    stream.write(reinterpret_cast<const char*>(head.data()), static_cast<std::streamsize>(head.size()));
+    stream.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size()));
+    if (!stream) {
+        throw std::runtime_error("Failed to write contour output: " + path.string());
+    }
+}
+
+ContourFileReader::ContourFileReader(const std::filesystem::path& path) : file_(path) {
+    ByteReader in(file_.bytes());
+    auto magic = in.bytes(sizeof(kMagic));
+    if (!std::equal(magic.begin(), magic.end(), kMagic)) {
+        throw std::runtime_error("Not a contour file: " + path.string());
+    }
+    if (std::uint16_t version = in.u16(); version != kVersion) {
+        throw std::runtime_error("Unsupported contour file version " + std::to_string(version) + ": " +
+                                 path.string());
+    }
+    in.u16();
+    std::uint32_t count = in.u32();
+    in.u32();
+    bounds_ = read_bounds(in);
+    if (count > in.remaining() / kEntrySize) {
+        throw std::runtime_error("Truncated contour file: " + path.string());
+    }
+    entries_.resize(count);
+    for (auto& entry : entries_) {
+        entry.bounds = read_bounds(in);
+        entry.offset = in.u64();
+        entry.size = in.u64();
+        if (entry.offset > file_.bytes().size() || entry.size > file_.bytes().size() - entry.offset ||
+            entry.size < kPropertiesSize) {
+            throw std::runtime_error("Corrupt contour file index: " + path.string());
+        }
+    }
+}
+
+MergedContour ContourFileReader::read(std::size_t feature) const {
+    const auto& entry = entries_.at(feature);
+    ByteReader in(file_.bytes().subspan(entry.offset, entry.size));
+
+    MergedContour contour;
+    auto phenomenon = in.bytes(kPhenomenonSize);
+    auto end = std::find(phenomenon.begin(), phenomenon.end(), std::uint8_t{0});
+    contour.phenomenon_type.assign(phenomenon.begin(), end);
+    contour.threshold_dbz = in.f64();
+    contour.max_reflectivity = in.f64();
+    if (double echo_top = in.f64(); !std::isnan(echo_top)) {
+        contour.max_echo_top_km = echo_top;
+    }
+
+    if (in.u8() != kWkbLittleEndian || in.u32() != kWkbPolygon) {
+        throw std::runtime_error("Unsupported contour geometry");
+    }
+    std::uint32_t rings = in.u32();
+    if (rings == 0) {
+        return contour;
+    }
+    contour.geometry.vertices = read_ring(in);
+    for (std::uint32_t r = 1; r < rings; ++r) {
+        contour.geometry.holes.push_back(read_ring(in));
+    }
+    return contour;
+}
+
+std::vector<std::size_t> ContourFileReader::query(const GeoBounds& area) const {
+    std::vector<std::size_t> hits;
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+        if (intersects(entries_[i].bounds, area)) {
+            hits.push_back(i);
+        }
+    }
+    return hits;
+}
+
+}  // namespace radar
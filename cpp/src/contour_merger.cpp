@@ -1,12 +1,15 @@
 #include "radar/contour_merger.h"
 
 #include <algorithm>
-#include <array>
-#include <fstream>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
 #include <limits>
 #include <numeric>
 #include <stdexcept>
 
+#include "radar/outline_tracer.h"
+
 namespace radar {
 
 namespace {
@@ -19,25 +22,15 @@ double cross(const GeoCoordinate& o, const GeoCoordinate& a, const GeoCoordinate
     return ax * by - ay * bx;
 }
 
-}
-
-Polygon ContourMerger::convex_hull(const std::vector<GeoCoordinate>& points) const {
-    if (points.size() <= 3) {
-        Polygon polygon;
-        polygon.vertices = points;
-        if (!polygon.vertices.empty()) {
-            polygon.vertices.push_back(polygon.vertices.front());
-        }
-        return polygon;
+bool coordinate_less(const GeoCoordinate& a, const GeoCoordinate& b) {
+    if (a.longitude_deg == b.longitude_deg) {
+        return a.latitude_deg < b.latitude_deg;
     }
-    std::vector<GeoCoordinate> sorted = points;
-    std::sort(sorted.begin(), sorted.end(), [](const GeoCoordinate& a, const GeoCoordinate& b) {
-        if (a.longitude_deg == b.longitude_deg) {
-            return a.latitude_deg < b.latitude_deg;
-        }
-        return a.longitude_deg < b.longitude_deg;
-    });
+    return a.longitude_deg < b.longitude_deg;
+}
 
+// Andrew's monotone chain over points sorted by coordinate_less; returns a closed ring.
+std::vector<GeoCoordinate> chain_hull(const std::vector<GeoCoordinate>& sorted) {
     std::vector<GeoCoordinate> hull;
     hull.reserve(sorted.size() * 2);
 
@@ -60,32 +53,67 @@ Polygon ContourMerger::convex_hull(const std::vector<GeoCoordinate>& points) con
         hull.pop_back();
         hull.push_back(hull.front());
     }
+    return hull;
+}
 
-    return Polygon{hull};
+// Open ring of a convex_hull() result in coordinate_less order. The ring runs along the lower
+// chain up to the last vertex and back along the upper chain, so both halves come out sorted.
+std::vector<GeoCoordinate> sorted_vertices(const Polygon& polygon) {
+    if (polygon.vertices.size() < 2) {
+        return polygon.vertices;
+    }
+    const auto begin = polygon.vertices.begin();
+    const auto end = polygon.vertices.end() - 1;
+    const auto last = std::max_element(begin, end, coordinate_less);
+    std::vector<GeoCoordinate> sorted;
+    sorted.reserve(static_cast<std::size_t>(end - begin));
+    auto lower_end = last + 1;
+    auto upper = std::make_reverse_iterator(end);
+    auto upper_end = std::make_reverse_iterator(lower_end);
+    if (std::is_sorted(begin, lower_end, coordinate_less) && std::is_sorted(upper, upper_end, coordinate_less)) {
+        std::merge(begin, lower_end, upper, upper_end, std::back_inserter(sorted), coordinate_less);
+    } else {
+        // Rings of three or fewer points are left as given.
+        sorted.assign(begin, end);
+        std::sort(sorted.begin(), sorted.end(), coordinate_less);
+    }
+    return sorted;
 }
 
-bool ContourMerger::bounding_boxes_intersect(const Polygon& a, const Polygon& b) {
-    auto compute_bounds = [](const Polygon& poly) {
-        double min_lat = std::numeric_limits<double>::max();
-        double max_lat = std::numeric_limits<double>::lowest();
-        double min_lon = std::numeric_limits<double>::max();
-        double max_lon = std::numeric_limits<double>::lowest();
-        for (const auto& vertex : poly.vertices) {
-            min_lat = std::min(min_lat, vertex.latitude_deg);
-            max_lat = std::max(max_lat, vertex.latitude_deg);
-            min_lon = std::min(min_lon, vertex.longitude_deg);
-            max_lon = std::max(max_lon, vertex.longitude_deg);
-        }
-        return std::array<double, 4>{min_lat, max_lat, min_lon, max_lon};
-    };
+}  // namespace
 
-    auto bounds_a = compute_bounds(a);
-    auto bounds_b = compute_bounds(b);
-    return !(bounds_a[1] < bounds_b[0] || bounds_b[1] < bounds_a[0] ||
-             bounds_a[3] < bounds_b[2] || bounds_b[3] < bounds_a[2]);
+Polygon ContourMerger::convex_hull(const std::vector<GeoCoordinate>& points) const {
+    if (points.size() <= 3) {
+        Polygon polygon;
+        polygon.vertices = points;
+        if (!polygon.vertices.empty()) {
+            polygon.vertices.push_back(polygon.vertices.front());
+        }
+        return polygon;
+    }
+    std::vector<GeoCoordinate> sorted = points;
+    std::sort(sorted.begin(), sorted.end(), coordinate_less);
+    return Polygon{chain_hull(sorted)};
 }
 
-Polygon ContourMerger::merge_polygons(const Polygon& a, const Polygon& b) {
+GeoBounds ContourMerger::bounds_of(const Polygon& polygon) {
+    GeoBounds bounds{std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest(),
+                     std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()};
+    for (const auto& vertex : polygon.vertices) {
+        bounds.min_latitude_deg = std::min(bounds.min_latitude_deg, vertex.latitude_deg);
+        bounds.max_latitude_deg = std::max(bounds.max_latitude_deg, vertex.latitude_deg);
+        bounds.min_longitude_deg = std::min(bounds.min_longitude_deg, vertex.longitude_deg);
+        bounds.max_longitude_deg = std::max(bounds.max_longitude_deg, vertex.longitude_deg);
+    }
+    return bounds;
+}
+
+bool ContourMerger::bounds_intersect(const GeoBounds& a, const GeoBounds& b) {
+    return !(a.max_latitude_deg < b.min_latitude_deg || b.max_latitude_deg < a.min_latitude_deg ||
+             a.max_longitude_deg < b.min_longitude_deg || b.max_longitude_deg < a.min_longitude_deg);
+}
+
+Polygon ContourMerger::merge_hulls(const Polygon& a, const Polygon& b) {
     std::vector<GeoCoordinate> points;
     if (!a.vertices.empty()) {
         points.insert(points.end(), a.vertices.begin(), a.vertices.end() - 1);
@@ -93,16 +121,124 @@ Polygon ContourMerger::merge_polygons(const Polygon& a, const Polygon& b) {
     if (!b.vertices.empty()) {
         points.insert(points.end(), b.vertices.begin(), b.vertices.end() - 1);
     }
-    ContourMerger merger;
-    return merger.convex_hull(points);
+    if (points.size() <= 3) {
+        ContourMerger merger;
+        return merger.convex_hull(points);
+    }
+    auto sorted_a = sorted_vertices(a);
+    auto sorted_b = sorted_vertices(b);
+    points.clear();
+    std::merge(sorted_a.begin(), sorted_a.end(), sorted_b.begin(), sorted_b.end(), std::back_inserter(points),
+               coordinate_less);
+    return Polygon{chain_hull(points)};
 }
 
-std::vector<MergedContour> ContourMerger::merge(const std::vector<Cluster>& clusters) const {
+std::vector<std::size_t> ContourMerger::group_overlapping(const std::vector<MergedContour>& contours,
+                                                          std::vector<GeoBounds> bounds) {
+    std::vector<std::size_t> parent(contours.size());
+    std::iota(parent.begin(), parent.end(), std::size_t{0});
+    auto find = [&](std::size_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+
+    std::vector<std::size_t> roots;
+    std::vector<std::vector<std::uint32_t>> buckets;
+    while (true) {
+        roots.clear();
+        for (std::size_t i = 0; i < contours.size(); ++i) {
+            if (find(i) == i) {
+                roots.push_back(i);
+            }
+        }
+        if (roots.size() < 2) {
+            break;
+        }
+
+        // Uniform grid over the group bounds, about one bucket per group.
+        GeoBounds extent = bounds[roots.front()];
+        for (auto root : roots) {
+            extent.min_latitude_deg = std::min(extent.min_latitude_deg, bounds[root].min_latitude_deg);
+            extent.max_latitude_deg = std::max(extent.max_latitude_deg, bounds[root].max_latitude_deg);
+            extent.min_longitude_deg = std::min(extent.min_longitude_deg, bounds[root].min_longitude_deg);
+            extent.max_longitude_deg = std::max(extent.max_longitude_deg, bounds[root].max_longitude_deg);
+        }
+        const auto side = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(roots.size()))));
+        const double lat_step = (extent.max_latitude_deg - extent.min_latitude_deg) / static_cast<double>(side);
+        const double lon_step = (extent.max_longitude_deg - extent.min_longitude_deg) / static_cast<double>(side);
+        auto bucket_of = [side](double value, double origin, double step) {
+            if (!(step > 0.0)) {
+                return std::size_t{0};
+            }
+            const double position = (value - origin) / step;
+            return position <= 0.0 ? std::size_t{0} : std::min(side - 1, static_cast<std::size_t>(position));
+        };
+        buckets.assign(side * side, {});
+
+        bool changed = false;
+        for (auto root : roots) {
+            const auto& box = bounds[root];
+            const auto row_begin = bucket_of(box.min_latitude_deg, extent.min_latitude_deg, lat_step);
+            const auto row_end = bucket_of(box.max_latitude_deg, extent.min_latitude_deg, lat_step);
+            const auto column_begin = bucket_of(box.min_longitude_deg, extent.min_longitude_deg, lon_step);
+            const auto column_end = bucket_of(box.max_longitude_deg, extent.min_longitude_deg, lon_step);
+            for (auto row = row_begin; row <= row_end; ++row) {
+                for (auto column = column_begin; column <= column_end; ++column) {
+                    auto& bucket = buckets[row * side + column];
+                    for (auto other : bucket) {
+                        if (contours[other].phenomenon_type != contours[root].phenomenon_type ||
+                            !bounds_intersect(box, bounds[other])) {
+                            continue;
+                        }
+                        auto a = find(root);
+                        auto b = find(other);
+                        if (a != b) {
+                            parent[std::max(a, b)] = std::min(a, b);
+                            changed = true;
+                        }
+                    }
+                    bucket.push_back(static_cast<std::uint32_t>(root));
+                }
+            }
+        }
+        if (!changed) {
+            break;
+        }
+        // Merged groups cover the bounds of all their members; look again with the grown boxes.
+        for (std::size_t i = 0; i < contours.size(); ++i) {
+            auto root = find(i);
+            if (root != i) {
+                auto& box = bounds[root];
+                box.min_latitude_deg = std::min(box.min_latitude_deg, bounds[i].min_latitude_deg);
+                box.max_latitude_deg = std::max(box.max_latitude_deg, bounds[i].max_latitude_deg);
+                box.min_longitude_deg = std::min(box.min_longitude_deg, bounds[i].min_longitude_deg);
+                box.max_longitude_deg = std::max(box.max_longitude_deg, bounds[i].max_longitude_deg);
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < contours.size(); ++i) {
+        parent[i] = find(i);
+    }
+    return parent;
+}
+
+ContourMerger::ContourMerger(ContourMergeOptions options) : options_(options) {}
+
+std::vector<MergedContour> ContourMerger::merge(const CellGrid& grid, const ClusterSet& clusters) const {
+    if (options_.mode == ContourMode::Outline) {
+        return merge_outlines(grid, clusters);
+    }
     std::vector<MergedContour> contours;
-    for (const auto& cluster : clusters) {
-        std::vector<GeoCoordinate> points;
-        for (const auto& cell : cluster.cells) {
-            points.insert(points.end(), cell.geometry.vertices.begin(), cell.geometry.vertices.end());
+    std::vector<GeoCoordinate> points;
+    for (const auto& cluster : clusters.clusters) {
+        points.clear();
+        for (auto index : clusters.members_of(cluster)) {
+            const auto cell = grid.geometry(index);
+            points.insert(points.end(), cell.vertices.begin(), cell.vertices.end());
         }
         if (points.empty()) {
             continue;
@@ -115,72 +251,65 @@ std::vector<MergedContour> ContourMerger::merge(const std::vector<Cluster>& clus
         contour.geometry = polygon;
         contour.max_reflectivity = cluster.max_reflectivity;
         contour.max_echo_top_km = cluster.max_echo_top_km;
-        if (!cluster.cells.empty()) {
-            contour.phenomenon_type = cluster.cells.front().phenomenon_type;
-        }
+        contour.phenomenon_type = grid.phenomenon(cluster.seed);
         contours.push_back(std::move(contour));
     }
 
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        for (std::size_t i = 0; i < contours.size(); ++i) {
-            for (std::size_t j = i + 1; j < contours.size(); ++j) {
-                if (contours[i].phenomenon_type != contours[j].phenomenon_type) {
-                    continue;
-                }
-                if (bounding_boxes_intersect(contours[i].geometry, contours[j].geometry)) {
-                    contours[i].geometry = merge_polygons(contours[i].geometry, contours[j].geometry);
-                    contours[i].max_reflectivity = std::max(contours[i].max_reflectivity, contours[j].max_reflectivity);
-                    if (contours[i].max_echo_top_km.has_value() || contours[j].max_echo_top_km.has_value()) {
-                        contours[i].max_echo_top_km = std::max(contours[i].max_echo_top_km.value_or(0.0),
-                                                              contours[j].max_echo_top_km.value_or(0.0));
-                    }
-                    contours.erase(contours.begin() + static_cast<long>(j));
-                    changed = true;
-                    break;
-                }
-            }
-            if (changed) {
-                break;
-            }
+    // Overlapping contours of one phenomenon become one, keeping the place of the earliest.
+    std::vector<GeoBounds> bounds;
+    bounds.reserve(contours.size());
+    for (const auto& contour : contours) {
+        bounds.push_back(bounds_of(contour.geometry));
+    }
+    auto groups = group_overlapping(contours, std::move(bounds));
+
+    std::vector<MergedContour> merged;
+    std::vector<std::size_t> slot(contours.size());
+    for (std::size_t i = 0; i < contours.size(); ++i) {
+        if (groups[i] == i) {
+            slot[i] = merged.size();
+            merged.push_back(std::move(contours[i]));
+            continue;
+        }
+        auto& target = merged[slot[groups[i]]];
+        const auto& source = contours[i];
+        target.geometry = merge_hulls(target.geometry, source.geometry);
+        target.max_reflectivity = std::max(target.max_reflectivity, source.max_reflectivity);
+        if (target.max_echo_top_km.has_value() || source.max_echo_top_km.has_value()) {
+            target.max_echo_top_km =
+                std::max(target.max_echo_top_km.value_or(0.0), source.max_echo_top_km.value_or(0.0));
         }
     }
+    return merged;
+}
 
+// Outlines follow the cells exactly, and cells of different clusters never touch, so outlines
+// cannot overlap and each cluster keeps its own contour.
+std::vector<MergedContour> ContourMerger::merge_outlines(const CellGrid& grid, const ClusterSet& clusters) const {
+    auto polygons = OutlineTracer(grid).trace(clusters);
+    std::vector<MergedContour> contours;
+    for (std::size_t c = 0; c < clusters.clusters.size(); ++c) {
+        if (polygons[c].vertices.empty()) {
+            continue;
+        }
+        const auto& cluster = clusters.clusters[c];
+        MergedContour contour;
+        contour.phenomenon_type = grid.phenomenon(cluster.seed);
+        contour.geometry = std::move(polygons[c]);
+        contour.max_reflectivity = cluster.max_reflectivity;
+        contour.max_echo_top_km = cluster.max_echo_top_km;
+        contours.push_back(std::move(contour));
+    }
     return contours;
 }
 
-void ContourMerger::write_geojson(const std::vector<MergedContour>& contours, const std::string& path) const {
-    std::ofstream stream(path);
-    if (!stream.is_open()) {
-        throw std::runtime_error("Cannot open GeoJSON output: " + path);
-    }
-    stream << "{\n  \"type\": \"FeatureCollection\",\n  \"features\": [\n";
-    for (std::size_t i = 0; i < contours.size(); ++i) {
-        const auto& contour = contours[i];
-        stream << "    {\n      \"type\": \"Feature\",\n      \"properties\": {\n";
-        stream << "        \"phenomenon\": \"" << contour.phenomenon_type << "\",\n";
-        stream << "        \"max_reflectivity\": " << contour.max_reflectivity << ",\n";
-        if (contour.max_echo_top_km.has_value()) {
-            stream << "        \"max_echo_top_km\": " << contour.max_echo_top_km.value() << "\n";
-        } else {
-            stream << "        \"max_echo_top_km\": null\n";
-        }
-        stream << "      },\n      \"geometry\": {\n        \"type\": \"Polygon\",\n        \"coordinates\": [\n          [";
-        for (std::size_t p = 0; p < contour.geometry.vertices.size(); ++p) {
-            const auto& vertex = contour.geometry.vertices[p];
-            stream << "[" << vertex.longitude_deg << ", " << vertex.latitude_deg << "]";
-            if (p + 1 != contour.geometry.vertices.size()) {
-                stream << ", ";
-            }
-        }
-        stream << "]\n        ]\n      }\n    }";
-        if (i + 1 != contours.size()) {
-            stream << ",";
-        }
-        stream << "\n";
+void ContourMerger::write_geojson(const std::vector<MergedContour>& contours, const std::string& path,
+                                  GeoJsonOptions options) const {
+    GeoJsonWriter writer(path, options);
+    for (const auto& contour : contours) {
+        writer.write(contour);
     }
-    stream << "  ]\n}\n";
+    writer.finish();
 }
 
 }  // namespace radar
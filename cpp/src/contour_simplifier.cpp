@@ -0,0 +1,341 @@
+#include "radar/contour_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+namespace radar {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kKmPerDegree = 6371.0 * kPi / 180.0;
+
+// Edge from vertex `index` of a ring to the next one.
+struct RingSegment {
+    GeoCoordinate from;
+    GeoCoordinate to;
+    std::uint32_t ring = 0;
+    std::uint32_t index = 0;
+};
+
+struct CoordinateHash {
+    std::size_t operator()(const GeoCoordinate& c) const {
+        std::uint64_t lat = 0;
+        std::uint64_t lon = 0;
+        std::memcpy(&lat, &c.latitude_deg, sizeof(lat));
+        std::memcpy(&lon, &c.longitude_deg, sizeof(lon));
+        return std::hash<std::uint64_t>{}(lat * 0x9E3779B97F4A7C15ULL ^ lon);
+    }
+};
+
+struct CoordinateEqual {
+    bool operator()(const GeoCoordinate& a, const GeoCoordinate& b) const {
+        return a.latitude_deg == b.latitude_deg && a.longitude_deg == b.longitude_deg;
+    }
+};
+
+double orientation(const GeoCoordinate& a, const GeoCoordinate& b, const GeoCoordinate& c) {
+    return (b.longitude_deg - a.longitude_deg) * (c.latitude_deg - a.latitude_deg) -
+           (b.latitude_deg - a.latitude_deg) * (c.longitude_deg - a.longitude_deg);
+}
+
+bool properly_cross(const GeoCoordinate& a, const GeoCoordinate& b, const GeoCoordinate& c, const GeoCoordinate& d) {
+    const double abc = orientation(a, b, c);
+    const double abd = orientation(a, b, d);
+    const double cda = orientation(c, d, a);
+    const double cdb = orientation(c, d, b);
+    return ((abc > 0 && abd < 0) || (abc < 0 && abd > 0)) && ((cda > 0 && cdb < 0) || (cda < 0 && cdb > 0));
+}
+
+// Uniform grid over the original ring edges; an edge is listed in every bucket its bounds touch,
+// so queries may see it more than once.
+class SegmentGrid {
+public:
+    explicit SegmentGrid(std::vector<RingSegment> segments) : segments_(std::move(segments)) {
+        if (segments_.empty()) {
+            return;
+        }
+        bounds_ = bounds_of(segments_.front());
+        for (const auto& segment : segments_) {
+            auto box = bounds_of(segment);
+            bounds_.min_latitude_deg = std::min(bounds_.min_latitude_deg, box.min_latitude_deg);
+            bounds_.max_latitude_deg = std::max(bounds_.max_latitude_deg, box.max_latitude_deg);
+            bounds_.min_longitude_deg = std::min(bounds_.min_longitude_deg, box.min_longitude_deg);
+            bounds_.max_longitude_deg = std::max(bounds_.max_longitude_deg, box.max_longitude_deg);
+        }
+        side_ = std::max<std::size_t>(1, static_cast<std::size_t>(std::sqrt(static_cast<double>(segments_.size()) / 4.0)));
+        buckets_.resize(side_ * side_);
+        for (std::size_t i = 0; i < segments_.size(); ++i) {
+            auto box = bounds_of(segments_[i]);
+            for (auto row = row_of(box.min_latitude_deg); row <= row_of(box.max_latitude_deg); ++row) {
+                for (auto column = column_of(box.min_longitude_deg); column <= column_of(box.max_longitude_deg);
+                     ++column) {
+                    buckets_[row * side_ + column].push_back(static_cast<std::uint32_t>(i));
+                }
+            }
+        }
+    }
+
+    template <typename Fn>
+    void for_each_near(const GeoBounds& box, Fn&& fn) const {
+        if (segments_.empty()) {
+            return;
+        }
+        for (auto row = row_of(box.min_latitude_deg); row <= row_of(box.max_latitude_deg); ++row) {
+            for (auto column = column_of(box.min_longitude_deg); column <= column_of(box.max_longitude_deg); ++column) {
+                for (auto i : buckets_[row * side_ + column]) {
+                    if (!fn(segments_[i])) {
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    static GeoBounds bounds_of(const RingSegment& segment) {
+        return GeoBounds{std::min(segment.from.latitude_deg, segment.to.latitude_deg),
+                         std::max(segment.from.latitude_deg, segment.to.latitude_deg),
+                         std::min(segment.from.longitude_deg, segment.to.longitude_deg),
+                         std::max(segment.from.longitude_deg, segment.to.longitude_deg)};
+    }
+    std::size_t bucket(double value, double low, double high) const {
+        if (!(high > low)) {
+            return 0;
+        }
+        const double position = (value - low) / (high - low) * static_cast<double>(side_);
+        return position <= 0.0 ? 0 : std::min(side_ - 1, static_cast<std::size_t>(position));
+    }
+    std::size_t row_of(double latitude) const {
+        return bucket(latitude, bounds_.min_latitude_deg, bounds_.max_latitude_deg);
+    }
+    std::size_t column_of(double longitude) const {
+        return bucket(longitude, bounds_.min_longitude_deg, bounds_.max_longitude_deg);
+    }
+
+    std::vector<RingSegment> segments_;
+    GeoBounds bounds_;
+    std::size_t side_ = 1;
+    std::vector<std::vector<std::uint32_t>> buckets_;
+};
+
+// Simplifies one closed ring in place. `locked` marks vertices that must survive.
+class RingSimplifier {
+public:
+    RingSimplifier(std::vector<GeoCoordinate>& ring, std::uint32_t ring_id, std::vector<bool> locked,
+                   const SegmentGrid& grid, double tolerance_km)
+        : ring_(ring), ring_id_(ring_id), count_(ring.size() - 1), kept_(std::move(locked)), grid_(grid),
+          tolerance_km_(tolerance_km) {
+        const double latitude = ring.front().latitude_deg * kPi / 180.0;
+        km_per_deg_lon_ = kKmPerDegree * std::cos(latitude);
+    }
+
+    void run() {
+        std::vector<std::size_t> anchors;
+        for (std::size_t i = 0; i < count_; ++i) {
+            if (kept_[i]) {
+                anchors.push_back(i);
+            }
+        }
+        if (anchors.empty()) {
+            anchors.push_back(0);
+        }
+        if (anchors.size() == 1) {
+            // A closed ring needs a second anchor; the vertex farthest from the first is on the hull.
+            std::size_t farthest = anchors.front();
+            double best = -1.0;
+            for (std::size_t i = 0; i < count_; ++i) {
+                double d = distance_km(ring_[anchors.front()], ring_[i]);
+                if (d > best) {
+                    best = d;
+                    farthest = i;
+                }
+            }
+            anchors.push_back(farthest);
+            std::sort(anchors.begin(), anchors.end());
+        }
+        for (auto anchor : anchors) {
+            kept_[anchor] = true;
+        }
+        for (std::size_t a = 0; a < anchors.size(); ++a) {
+            const std::size_t first = anchors[a];
+            std::size_t last = anchors[(a + 1) % anchors.size()];
+            if (last <= first) {
+                last += count_;
+            }
+            simplify_run(first, last);
+        }
+
+        const auto kept = static_cast<std::size_t>(std::count(kept_.begin(), kept_.end(), true));
+        if (kept < 3) {
+            return;  // would collapse; keep the ring as traced
+        }
+        std::vector<GeoCoordinate> simplified;
+        simplified.reserve(kept + 1);
+        for (std::size_t i = 0; i < count_; ++i) {
+            if (kept_[i]) {
+                simplified.push_back(ring_[i]);
+            }
+        }
+        simplified.push_back(simplified.front());
+        ring_ = std::move(simplified);
+    }
+
+private:
+    const GeoCoordinate& at(std::size_t position) const { return ring_[position % count_]; }
+
+    double distance_km(const GeoCoordinate& a, const GeoCoordinate& b) const {
+        const double dx = (b.longitude_deg - a.longitude_deg) * km_per_deg_lon_;
+        const double dy = (b.latitude_deg - a.latitude_deg) * kKmPerDegree;
+        return std::hypot(dx, dy);
+    }
+
+    double distance_to_chord_km(const GeoCoordinate& p, const GeoCoordinate& a, const GeoCoordinate& b) const {
+        const double bx = (b.longitude_deg - a.longitude_deg) * km_per_deg_lon_;
+        const double by = (b.latitude_deg - a.latitude_deg) * kKmPerDegree;
+        const double px = (p.longitude_deg - a.longitude_deg) * km_per_deg_lon_;
+        const double py = (p.latitude_deg - a.latitude_deg) * kKmPerDegree;
+        const double length = std::hypot(bx, by);
+        if (length == 0.0) {
+            return std::hypot(px, py);
+        }
+        return std::abs(bx * py - by * px) / length;
+    }
+
+    // Positions are unwrapped, so a run may pass the ring's start; `last` may equal first + count_.
+    void simplify_run(std::size_t first, std::size_t last) {
+        std::vector<std::pair<std::size_t, std::size_t>> stack{{first, last}};
+        while (!stack.empty()) {
+            auto [from, to] = stack.back();
+            stack.pop_back();
+            if (to - from < 2) {
+                continue;
+            }
+            std::size_t split = from + 1;
+            double worst = -1.0;
+            for (std::size_t p = from + 1; p < to; ++p) {
+                double d = distance_to_chord_km(at(p), at(from), at(to));
+                if (d > worst) {
+                    worst = d;
+                    split = p;
+                }
+            }
+            if (worst > tolerance_km_ || !chord_is_safe(from, to)) {
+                kept_[split % count_] = true;
+                stack.emplace_back(from, split);
+                stack.emplace_back(split, to);
+            }
+        }
+    }
+
+    // A chord may replace the run from..to when it crosses no edge of another ring, or of this
+    // ring outside the run, and no such vertex lies in the polygon bounded by the run and the
+    // chord. Other rings only lose vertices inside areas that hold none of ours, so two chords
+    // that both pass can never cross.
+    bool chord_is_safe(std::size_t from, std::size_t to) const {
+        const auto& a = at(from);
+        const auto& b = at(to);
+        GeoBounds box{a.latitude_deg, a.latitude_deg, a.longitude_deg, a.longitude_deg};
+        for (std::size_t p = from; p <= to; ++p) {
+            box.min_latitude_deg = std::min(box.min_latitude_deg, at(p).latitude_deg);
+            box.max_latitude_deg = std::max(box.max_latitude_deg, at(p).latitude_deg);
+            box.min_longitude_deg = std::min(box.min_longitude_deg, at(p).longitude_deg);
+            box.max_longitude_deg = std::max(box.max_longitude_deg, at(p).longitude_deg);
+        }
+        const std::size_t start = from % count_;
+        bool safe = true;
+        grid_.for_each_near(box, [&](const RingSegment& segment) {
+            // Edges from..to - 1 of this ring are the run itself.
+            if (segment.ring == ring_id_ && (segment.index + count_ - start) % count_ < to - from) {
+                return true;
+            }
+            if (properly_cross(a, b, segment.from, segment.to) || encloses(from, to, segment.from)) {
+                safe = false;
+            }
+            return safe;
+        });
+        return safe;
+    }
+
+    // Even-odd test of `point` against the polygon formed by the run and its chord.
+    bool encloses(std::size_t from, std::size_t to, const GeoCoordinate& point) const {
+        const auto& a = at(from);
+        const auto& b = at(to);
+        if (CoordinateEqual{}(point, a) || CoordinateEqual{}(point, b)) {
+            return false;
+        }
+        bool inside = false;
+        for (std::size_t i = from, j = to; i <= to; j = i++) {
+            const auto& vi = at(i);
+            const auto& vj = at(j);
+            if ((vi.latitude_deg > point.latitude_deg) != (vj.latitude_deg > point.latitude_deg) &&
+                point.longitude_deg < (vj.longitude_deg - vi.longitude_deg) * (point.latitude_deg - vi.latitude_deg) /
+                                              (vj.latitude_deg - vi.latitude_deg) +
+                                          vi.longitude_deg) {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    std::vector<GeoCoordinate>& ring_;
+    std::uint32_t ring_id_;
+    std::size_t count_;  // distinct vertices; the ring repeats the first at the end
+    std::vector<bool> kept_;
+    const SegmentGrid& grid_;
+    double tolerance_km_;
+    double km_per_deg_lon_ = kKmPerDegree;
+};
+
+}  // namespace
+
+ContourSimplifier::ContourSimplifier(SimplifyOptions options) : options_(options) {}
+
+SimplifyStats ContourSimplifier::simplify(std::vector<MergedContour>& contours) const {
+    std::vector<std::vector<GeoCoordinate>*> rings;
+    for (auto& contour : contours) {
+        rings.push_back(&contour.geometry.vertices);
+        for (auto& hole : contour.geometry.holes) {
+            rings.push_back(&hole);
+        }
+    }
+
+    SimplifyStats stats;
+    std::vector<RingSegment> segments;
+    std::unordered_map<GeoCoordinate, std::uint32_t, CoordinateHash, CoordinateEqual> occurrences;
+    for (std::size_t r = 0; r < rings.size(); ++r) {
+        stats.vertices_before += rings[r]->size();
+        for (std::size_t i = 0; i + 1 < rings[r]->size(); ++i) {
+            segments.push_back(RingSegment{(*rings[r])[i], (*rings[r])[i + 1], static_cast<std::uint32_t>(r),
+                                           static_cast<std::uint32_t>(i)});
+            ++occurrences[(*rings[r])[i]];
+        }
+    }
+
+    if (options_.tolerance_km > 0.0) {
+        const SegmentGrid grid(std::move(segments));
+        for (std::size_t r = 0; r < rings.size(); ++r) {
+            auto& ring = *rings[r];
+            // Triangles have nothing to give up.
+            if (ring.size() <= 4) {
+                continue;
+            }
+            std::vector<bool> locked(ring.size() - 1);
+            for (std::size_t i = 0; i + 1 < ring.size(); ++i) {
+                locked[i] = occurrences[ring[i]] > 1;
+            }
+            RingSimplifier(ring, static_cast<std::uint32_t>(r), std::move(locked), grid, options_.tolerance_km).run();
+        }
+    }
+
+    for (const auto* ring : rings) {
+        stats.vertices_after += ring->size();
+    }
+    return stats;
+}
+
+}  // namespace radar
@@ -0,0 +1,481 @@
+#include "radar/deflate.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace radar {
+namespace {
+
+constexpr std::size_t kWindowSize = 32768;
+constexpr std::size_t kMinMatch = 3;
+constexpr std::size_t kMaxMatch = 258;
+constexpr int kHashBits = 15;
+constexpr int kMaxChain = 32;
+constexpr std::size_t kTokensPerBlock = 1 << 16;
+constexpr std::size_t kMaxStoredBytes = 65535;
+constexpr int kMaxCodeLength = 15;
+constexpr int kMaxCodeLengthCodeLength = 7;
+constexpr std::size_t kLitLenCodes = 286;
+constexpr std::size_t kDistanceCodes = 30;
+constexpr std::size_t kEndOfBlock = 256;
+
+constexpr std::array<std::uint16_t, 29> kLengthBase = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                       31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<std::uint8_t, 29> kLengthExtra = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                       2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<std::uint16_t, 30> kDistanceBase = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                                         33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                                         1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::array<std::uint8_t, 30> kDistanceExtra = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                         6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+constexpr std::array<std::uint8_t, 19> kCodeLengthOrder = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// Literal (distance == 0) or back-reference.
+struct Token {
+    std::uint16_t value;  // literal byte or match length
+    std::uint16_t distance;
+};
+
+std::size_t length_code(std::size_t length) {
+    static const auto table = [] {
+        std::array<std::uint8_t, kMaxMatch + 1> codes{};
+        for (std::size_t code = 0; code < kLengthBase.size(); ++code) {
+            const std::size_t end = code + 1 < kLengthBase.size() ? kLengthBase[code + 1] : kMaxMatch + 1;
+            for (std::size_t length = kLengthBase[code]; length < end; ++length) {
+                codes[length] = static_cast<std::uint8_t>(code);
+            }
+        }
+        codes[kMaxMatch] = 28;  // 258 has its own code rather than 227 + 31
+        return codes;
+    }();
+    return table[length];
+}
+
+std::size_t distance_code(std::size_t distance) {
+    return static_cast<std::size_t>(std::upper_bound(kDistanceBase.begin(), kDistanceBase.end(), distance) -
+                                    kDistanceBase.begin()) -
+           1;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<std::uint8_t>& out) : out_(out) {}
+
+    // Bits go out least significant first; n <= 32.
+    void put(std::uint32_t bits, int n) {
+        buffer_ |= static_cast<std::uint64_t>(bits) << count_;
+        count_ += n;
+        while (count_ >= 8) {
+            out_.push_back(static_cast<std::uint8_t>(buffer_));
+            buffer_ >>= 8;
+            count_ -= 8;
+        }
+    }
+    void align() {
+        if (count_ > 0) {
+            out_.push_back(static_cast<std::uint8_t>(buffer_));
+            buffer_ = 0;
+            count_ = 0;
+        }
+    }
+    // Copies bytes after padding to a byte boundary.
+    void bytes(std::span<const std::uint8_t> data) {
+        align();
+        out_.insert(out_.end(), data.begin(), data.end());
+    }
+
+private:
+    std::vector<std::uint8_t>& out_;
+    std::uint64_t buffer_ = 0;
+    int count_ = 0;
+};
+
+// Huffman code lengths for `freq`, capped at `limit` bits. Unused symbols get length 0; at least
+// two symbols always get a code so the code is complete.
+std::vector<std::uint8_t> code_lengths(std::vector<std::uint32_t> freq, int limit) {
+    std::vector<std::uint8_t> lengths(freq.size(), 0);
+    std::vector<std::uint32_t> leaves;
+    for (std::uint32_t s = 0; s < freq.size(); ++s) {
+        if (freq[s] > 0) {
+            leaves.push_back(s);
+        }
+    }
+    for (std::uint32_t s = 0; leaves.size() < 2; ++s) {
+        if (freq[s] == 0) {
+            freq[s] = 1;
+            leaves.push_back(s);
+        }
+    }
+    std::sort(leaves.begin(), leaves.end(),
+              [&](std::uint32_t a, std::uint32_t b) { return freq[a] != freq[b] ? freq[a] < freq[b] : a < b; });
+
+    // Two-queue Huffman construction: leaves are sorted and internal nodes are created in
+    // non-decreasing weight order. Nodes [0, m) are the leaves, [m, 2m - 1) the internal nodes.
+    const std::size_t m = leaves.size();
+    std::vector<std::uint64_t> weight(2 * m - 1);
+    std::vector<std::uint32_t> parent(2 * m - 1, 0);
+    for (std::size_t i = 0; i < m; ++i) {
+        weight[i] = freq[leaves[i]];
+    }
+    std::size_t next_leaf = 0;
+    std::size_t next_internal = m;
+    auto take = [&](std::size_t created) {
+        if (next_leaf < m && (next_internal >= created || weight[next_leaf] <= weight[next_internal])) {
+            return next_leaf++;
+        }
+        return next_internal++;
+    };
+    for (std::size_t node = m; node < 2 * m - 1; ++node) {
+        const std::size_t a = take(node);
+        const std::size_t b = take(node);
+        weight[node] = weight[a] + weight[b];
+        parent[a] = parent[b] = static_cast<std::uint32_t>(node);
+    }
+    std::vector<std::uint32_t> depth(2 * m - 1, 0);
+    for (std::size_t node = 2 * m - 1; node-- > 0;) {
+        if (node != 2 * m - 2) {
+            depth[node] = depth[parent[node]] + 1;
+        }
+    }
+
+    // Fold deeper leaves into the limit, then move codes down until the Kraft sum is exact.
+    std::vector<std::uint32_t> count(static_cast<std::size_t>(limit) + 1, 0);
+    for (std::size_t i = 0; i < m; ++i) {
+        ++count[std::min<std::uint32_t>(depth[i], static_cast<std::uint32_t>(limit))];
+    }
+    std::uint64_t total = 0;
+    for (int bits = limit; bits > 0; --bits) {
+        total += static_cast<std::uint64_t>(count[bits]) << (limit - bits);
+    }
+    while (total != (std::uint64_t{1} << limit)) {
+        --count[limit];
+        for (int bits = limit - 1; bits > 0; --bits) {
+            if (count[bits] > 0) {
+                --count[bits];
+                count[bits + 1] += 2;
+                break;
+            }
+        }
+        --total;
+    }
+
+    // Rarest symbols take the longest codes.
+    std::size_t leaf = 0;
+    for (int bits = limit; bits > 0; --bits) {
+        for (std::uint32_t n = 0; n < count[bits]; ++n) {
+            lengths[leaves[leaf++]] = static_cast<std::uint8_t>(bits);
+        }
+    }
+    return lengths;
+}
+
+// Canonical codes, bit-reversed because DEFLATE sends Huffman codes most significant bit first.
+std::vector<std::uint16_t> canonical_codes(const std::vector<std::uint8_t>& lengths) {
+    std::array<std::uint16_t, kMaxCodeLength + 2> next{};
+    std::array<std::uint16_t, kMaxCodeLength + 1> count{};
+    for (auto length : lengths) {
+        ++count[length];
+    }
+    count[0] = 0;
+    for (int bits = 1; bits <= kMaxCodeLength; ++bits) {
+        next[bits + 1] = static_cast<std::uint16_t>((next[bits] + count[bits]) << 1);
+    }
+    std::vector<std::uint16_t> codes(lengths.size(), 0);
+    for (std::size_t s = 0; s < lengths.size(); ++s) {
+        const int bits = lengths[s];
+        if (bits == 0) {
+            continue;
+        }
+        std::uint16_t code = next[bits]++;
+        std::uint16_t reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            reversed = static_cast<std::uint16_t>((reversed << 1) | ((code >> b) & 1));
+        }
+        codes[s] = reversed;
+    }
+    return codes;
+}
+
+// Stored (BTYPE 00) blocks holding `data` as is, at most kMaxStoredBytes each.
+void write_stored(std::span<const std::uint8_t> data, bool final, BitWriter& bits) {
+    std::size_t begin = 0;
+    do {
+        const std::size_t length = std::min(kMaxStoredBytes, data.size() - begin);
+        bits.put(final && begin + length == data.size() ? 1 : 0, 1);
+        bits.put(0, 2);
+        bits.align();
+        bits.put(static_cast<std::uint32_t>(length), 16);
+        bits.put(static_cast<std::uint32_t>(~length & 0xFFFF), 16);
+        bits.bytes(data.subspan(begin, length));
+        begin += length;
+    } while (begin < data.size());
+}
+
+// One dynamic Huffman block for `tokens`, which encode `data`; stored blocks instead when
+// those come out smaller, as they do for incompressible data.
+void write_block(std::span<const Token> tokens, std::span<const std::uint8_t> data, bool final, BitWriter& bits) {
+    std::vector<std::uint32_t> litlen_freq(kLitLenCodes, 0);
+    std::vector<std::uint32_t> distance_freq(kDistanceCodes, 0);
+    for (const auto& token : tokens) {
+        if (token.distance == 0) {
+            ++litlen_freq[token.value];
+        } else {
+            ++litlen_freq[257 + length_code(token.value)];
+            ++distance_freq[distance_code(token.distance)];
+        }
+    }
+    litlen_freq[kEndOfBlock] = 1;
+    const auto litlen_lengths = code_lengths(litlen_freq, kMaxCodeLength);
+    const auto distance_lengths = code_lengths(distance_freq, kMaxCodeLength);
+    const auto litlen_codes = canonical_codes(litlen_lengths);
+    const auto distance_codes = canonical_codes(distance_lengths);
+
+    std::size_t hlit = kLitLenCodes;
+    while (hlit > 257 && litlen_lengths[hlit - 1] == 0) {
+        --hlit;
+    }
+    std::size_t hdist = kDistanceCodes;
+    while (hdist > 1 && distance_lengths[hdist - 1] == 0) {
+        --hdist;
+    }
+
+    // Both length tables run-length coded with symbols 16 (repeat previous), 17 and 18 (zeros).
+    std::vector<std::uint8_t> sequence(litlen_lengths.begin(), litlen_lengths.begin() + static_cast<std::ptrdiff_t>(hlit));
+    sequence.insert(sequence.end(), distance_lengths.begin(), distance_lengths.begin() + static_cast<std::ptrdiff_t>(hdist));
+    struct RunSymbol {
+        std::uint8_t symbol;
+        std::uint8_t extra;
+    };
+    std::vector<RunSymbol> runs;
+    for (std::size_t i = 0; i < sequence.size();) {
+        const std::uint8_t value = sequence[i];
+        std::size_t run = 1;
+        while (i + run < sequence.size() && sequence[i + run] == value) {
+            ++run;
+        }
+        i += run;
+        if (value == 0) {
+            while (run >= 11) {
+                const std::size_t n = std::min<std::size_t>(run, 138);
+                runs.push_back({18, static_cast<std::uint8_t>(n - 11)});
+                run -= n;
+            }
+            if (run >= 3) {
+                runs.push_back({17, static_cast<std::uint8_t>(run - 3)});
+                run = 0;
+            }
+        } else {
+            runs.push_back({value, 0});
+            --run;
+            while (run >= 3) {
+                const std::size_t n = std::min<std::size_t>(run, 6);
+                runs.push_back({16, static_cast<std::uint8_t>(n - 3)});
+                run -= n;
+            }
+        }
+        for (; run > 0; --run) {
+            runs.push_back({value, 0});
+        }
+    }
+    std::vector<std::uint32_t> run_freq(19, 0);
+    for (const auto& run : runs) {
+        ++run_freq[run.symbol];
+    }
+    const auto run_lengths = code_lengths(run_freq, kMaxCodeLengthCodeLength);
+    const auto run_codes = canonical_codes(run_lengths);
+    std::size_t hclen = kCodeLengthOrder.size();
+    while (hclen > 4 && run_lengths[kCodeLengthOrder[hclen - 1]] == 0) {
+        --hclen;
+    }
+
+    std::size_t dynamic_bits = 3 + 5 + 5 + 4 + 3 * hclen;
+    for (const auto& run : runs) {
+        dynamic_bits += run_lengths[run.symbol];
+        dynamic_bits += run.symbol == 16 ? 2 : run.symbol == 17 ? 3 : run.symbol == 18 ? 7 : 0;
+    }
+    for (std::size_t s = 0; s < kLitLenCodes; ++s) {
+        dynamic_bits += std::size_t{litlen_freq[s]} * (litlen_lengths[s] + (s > kEndOfBlock ? kLengthExtra[s - 257] : 0));
+    }
+    for (std::size_t d = 0; d < kDistanceCodes; ++d) {
+        dynamic_bits += std::size_t{distance_freq[d]} * (distance_lengths[d] + kDistanceExtra[d]);
+    }
+    // Header, padding of at most 7 bits, LEN and NLEN per stored block, then the bytes.
+    const std::size_t stored_blocks = std::max<std::size_t>(1, (data.size() + kMaxStoredBytes - 1) / kMaxStoredBytes);
+    const std::size_t stored_bits = stored_blocks * (3 + 7 + 32) + 8 * data.size();
+    if (stored_bits < dynamic_bits) {
+        write_stored(data, final, bits);
+        return;
+    }
+
+    bits.put(final ? 1 : 0, 1);
+    bits.put(2, 2);  // dynamic Huffman
+    bits.put(static_cast<std::uint32_t>(hlit - 257), 5);
+    bits.put(static_cast<std::uint32_t>(hdist - 1), 5);
+    bits.put(static_cast<std::uint32_t>(hclen - 4), 4);
+    for (std::size_t i = 0; i < hclen; ++i) {
+        bits.put(run_lengths[kCodeLengthOrder[i]], 3);
+    }
+    for (const auto& run : runs) {
+        bits.put(run_codes[run.symbol], run_lengths[run.symbol]);
+        if (run.symbol == 16) {
+            bits.put(run.extra, 2);
+        } else if (run.symbol == 17) {
+            bits.put(run.extra, 3);
+        } else if (run.symbol == 18) {
+            bits.put(run.extra, 7);
+        }
+    }
+
+    for (const auto& token : tokens) {
+        if (token.distance == 0) {
+            bits.put(litlen_codes[token.value], litlen_lengths[token.value]);
+            continue;
+        }
+        const std::size_t lcode = length_code(token.value);
+        bits.put(litlen_codes[257 + lcode], litlen_lengths[257 + lcode]);
+        bits.put(static_cast<std::uint32_t>(token.value - kLengthBase[lcode]), kLengthExtra[lcode]);
+        const std::size_t dcode = distance_code(token.distance);
+        bits.put(distance_codes[dcode], distance_lengths[dcode]);
+        bits.put(static_cast<std::uint32_t>(token.distance - kDistanceBase[dcode]), kDistanceExtra[dcode]);
+    }
+    bits.put(litlen_codes[kEndOfBlock], litlen_lengths[kEndOfBlock]);
+}
+
+// Greedy LZ77 over hash chains of three-byte prefixes.
+std::vector<Token> find_matches(std::span<const std::uint8_t> data) {
+    std::vector<Token> tokens;
+    tokens.reserve(data.size() / 8 + 16);
+    const std::size_t n = data.size();
+    std::vector<std::int32_t> head(std::size_t{1} << kHashBits, -1);
+    std::vector<std::int32_t> previous(n, -1);
+    auto hash = [&](std::size_t p) {
+        return ((static_cast<std::uint32_t>(data[p]) << 10) ^ (static_cast<std::uint32_t>(data[p + 1]) << 5) ^
+                data[p + 2]) &
+               ((1u << kHashBits) - 1);
+    };
+    auto insert = [&](std::size_t p) {
+        if (p + kMinMatch <= n) {
+            const auto h = hash(p);
+            previous[p] = head[h];
+            head[h] = static_cast<std::int32_t>(p);
+        }
+    };
+
+    std::size_t p = 0;
+    while (p < n) {
+        std::size_t best_length = 0;
+        std::size_t best_distance = 0;
+        if (p + kMinMatch <= n) {
+            const std::size_t max_length = std::min(kMaxMatch, n - p);
+            std::int32_t candidate = head[hash(p)];
+            for (int chain = 0; candidate >= 0 && chain < kMaxChain; ++chain) {
+                const std::size_t c = static_cast<std::size_t>(candidate);
+                if (p - c > kWindowSize) {
+                    break;
+                }
+                if (data[c + best_length] == data[p + best_length] || best_length == 0) {
+                    std::size_t length = 0;
+                    while (length < max_length && data[c + length] == data[p + length]) {
+                        ++length;
+                    }
+                    if (length > best_length) {
+                        best_length = length;
+                        best_distance = p - c;
+                        if (length == max_length) {
+                            break;
+                        }
+                    }
+                }
+                candidate = previous[c];
+            }
+        }
+        if (best_length >= kMinMatch) {
+            tokens.push_back({static_cast<std::uint16_t>(best_length), static_cast<std::uint16_t>(best_distance)});
+            for (std::size_t end = p + best_length; p < end; ++p) {
+                insert(p);
+            }
+        } else {
+            tokens.push_back({data[p], 0});
+            insert(p);
+            ++p;
+        }
+    }
+    return tokens;
+}
+
+}  // namespace
+
+void deflate_compress(std::span<const std::uint8_t> data, bool final, std::vector<std::uint8_t>& out) {
+    const auto tokens = find_matches(data);
+    BitWriter bits(out);
+    std::size_t begin = 0;
+    std::size_t data_begin = 0;
+    do {
+        const std::size_t end = std::min(tokens.size(), begin + kTokensPerBlock);
+        std::size_t data_end = data_begin;
+        for (std::size_t t = begin; t < end; ++t) {
+            data_end += tokens[t].distance == 0 ? 1 : tokens[t].value;
+        }
+        write_block(std::span<const Token>(tokens).subspan(begin, end - begin),
+                    data.subspan(data_begin, data_end - data_begin), final && end == tokens.size(), bits);
+        begin = end;
+        data_begin = data_end;
+    } while (begin < tokens.size());
+    if (!final) {
+        bits.put(0, 3);  // empty stored block: byte-aligns the chunk
+        bits.align();
+        out.insert(out.end(), {0x00, 0x00, 0xFF, 0xFF});
+    }
+    bits.align();
+}
+
+std::uint32_t adler32(std::span<const std::uint8_t> data, std::uint32_t adler) {
+    constexpr std::uint32_t kBase = 65521;
+    constexpr std::size_t kChunk = 5552;  // largest run before the sums can overflow 32 bits
+    std::uint32_t a = adler & 0xFFFF;
+    std::uint32_t b = adler >> 16;
+    for (std::size_t begin = 0; begin < data.size(); begin += kChunk) {
+        const std::size_t end = std::min(data.size(), begin + kChunk);
+        for (std::size_t i = begin; i < end; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= kBase;
+        b %= kBase;
+    }
+    return (b << 16) | a;
+}
+
+std::uint32_t adler32_combine(std::uint32_t adler_a, std::uint32_t adler_b, std::size_t length_b) {
+    constexpr std::uint64_t kBase = 65521;
+    const std::uint64_t remainder = length_b % kBase;
+    std::uint64_t a = adler_a & 0xFFFF;
+    std::uint64_t b = (remainder * a) % kBase;
+    a += (adler_b & 0xFFFF) + kBase - 1;
+    b += (adler_a >> 16) + (adler_b >> 16) + kBase - remainder;
+    a %= kBase;
+    b %= kBase;
+    return static_cast<std::uint32_t>((b << 16) | a);
+}
+
+std::uint32_t crc32(std::span<const std::uint8_t> data, std::uint32_t crc) {
+    static const auto table = [] {
+        std::array<std::uint32_t, 256> entries{};
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+        return entries;
+    }();
+    crc = ~crc;
+    for (auto byte : data) {
+        crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+}  // namespace radar
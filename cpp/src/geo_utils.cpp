@@ -1,5 +1,6 @@
 #include "radar/geo_utils.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace radar {
@@ -15,19 +16,36 @@ GeoCoordinate to_geo(double lat_rad, double lon_rad) {
 
 }  // namespace
 
+double cell_area_km2(const CellGeometry& cell) {
+    // compute_geometry() lists the corners front pair first, then back pair, which traces a bow
+    // tie; order them around the centre before applying the shoelace formula.
+    const double km_per_deg_lat = kEarthRadiusKm * kDegToRad;
+    const double km_per_deg_lon = km_per_deg_lat * std::cos(cell.center.latitude_deg * kDegToRad);
+    std::array<std::array<double, 3>, 4> corners{};
+    for (std::size_t i = 0; i < corners.size(); ++i) {
+        const double x = (cell.vertices[i].longitude_deg - cell.center.longitude_deg) * km_per_deg_lon;
+        const double y = (cell.vertices[i].latitude_deg - cell.center.latitude_deg) * km_per_deg_lat;
+        corners[i] = {std::atan2(y, x), x, y};
+    }
+    std::sort(corners.begin(), corners.end());
+    double twice_area = 0.0;
+    for (std::size_t i = 0; i < corners.size(); ++i) {
+        const auto& a = corners[i];
+        const auto& b = corners[(i + 1) % corners.size()];
+        twice_area += a[1] * b[2] - b[1] * a[2];
+    }
+    return std::abs(twice_area) / 2.0;
+}
+
 GeoCalculator::GeoCalculator(double radar_lat_deg, double radar_lon_deg, double radar_alt_m)
     : radar_lat_rad_(radar_lat_deg * kDegToRad),
       radar_lon_rad_(radar_lon_deg * kDegToRad),
       radar_alt_m_(radar_alt_m) {}
 
 CellGeometry GeoCalculator::compute_geometry(const RadarObservation& obs, double gate_length_km) const {
-    double azimuth_rad = obs.azimuth_deg * kDegToRad;
-    double elevation_rad = obs.elevation_deg * kDegToRad;
-
-    double slant_range_km = obs.range_km;
-    double ground_range_km = slant_range_km * std::cos(elevation_rad);
+    double ground_range_km = obs.range_km * std::cos(obs.elevation_deg * kDegToRad);
 
-    GeoCoordinate center = move(to_geo(radar_lat_rad_, radar_lon_rad_), ground_range_km, obs.azimuth_deg);
+    GeoCoordinate center = compute_center(obs);
 
     double half_gate = gate_length_km / 2.0;
     double half_angle = std::asin(half_gate / (2 * ground_range_km + 1e-6)) * kRadToDeg;
@@ -40,6 +58,12 @@ CellGeometry GeoCalculator::compute_geometry(const RadarObservation& obs, double
     return CellGeometry{center, {v1, v2, v3, v4}};
 }
 
+GeoCoordinate GeoCalculator::compute_center(const RadarObservation& obs) const {
+    double slant_range_km = obs.range_km;
+    double ground_range_km = slant_range_km * std::cos(obs.elevation_deg * kDegToRad);
+    return move(to_geo(radar_lat_rad_, radar_lon_rad_), ground_range_km, obs.azimuth_deg);
+}
+
 GeoCoordinate GeoCalculator::move(const GeoCoordinate& start, double distance_km, double azimuth_deg) const {
     double azimuth_rad = azimuth_deg * kDegToRad;
     double lat_rad = start.latitude_deg * kDegToRad;
@@ -0,0 +1,145 @@
+#include "radar/geojson_writer.h"
+
+#include <charconv>
+#include <stdexcept>
+#include <system_error>
+
+#include "radar/contour_merger.h"
+
+namespace radar {
+
+namespace {
+
+constexpr std::size_t kFlushBytes = 1 << 20;
+constexpr int kDefaultSignificantDigits = 6;  // what operator<< prints by default
+
+}  // namespace
+
+GeoJsonWriter::GeoJsonWriter(const std::string& path, GeoJsonOptions options)
+    : stream_(path, std::ios::binary), options_(options) {
+    if (!stream_.is_open()) {
+        throw std::runtime_error("Cannot open GeoJSON output: " + path);
+    }
+    buffer_.reserve(kFlushBytes + (kFlushBytes >> 2));
+    append(options_.compact ? "{\"type\":\"FeatureCollection\",\"features\":["
+                            : "{\n  \"type\": \"FeatureCollection\",\n  \"features\": [\n");
+}
+
+GeoJsonWriter::~GeoJsonWriter() {
+    if (!finished_) {
+        try {
+            finish();
+        } catch (...) {
+            // Destructors must not throw; call finish() to see write errors.
+        }
+    }
+}
+
+void GeoJsonWriter::write(const MergedContour& contour) {
+    if (finished_) {
+        throw std::runtime_error("GeoJSON collection already finished");
+    }
+    const bool compact = options_.compact;
+    if (features_ > 0) {
+        append(compact ? "," : ",\n");
+    }
+    ++features_;
+
+    append(compact ? "{\"type\":\"Feature\",\"properties\":{\"phenomenon\":"
+                   : "    {\n      \"type\": \"Feature\",\n      \"properties\": {\n        \"phenomenon\": ");
+    append_string(contour.phenomenon_type);
+    append(compact ? ",\"threshold_dbz\":" : ",\n        \"threshold_dbz\": ");
+    append_number(contour.threshold_dbz, -1);
+    append(compact ? ",\"max_reflectivity\":" : ",\n        \"max_reflectivity\": ");
+    append_number(contour.max_reflectivity, -1);
+    append(compact ? ",\"max_echo_top_km\":" : ",\n        \"max_echo_top_km\": ");
+    if (contour.max_echo_top_km.has_value()) {
+        append_number(contour.max_echo_top_km.value(), -1);
+    } else {
+        append("null");
+    }
+    append(compact ? "},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":["
+                   : "\n      },\n      \"geometry\": {\n        \"type\": \"Polygon\",\n        \"coordinates\": [\n");
+    append_ring(contour.geometry.vertices);
+    for (const auto& hole : contour.geometry.holes) {
+        append(compact ? "," : ",\n");
+        append_ring(hole);
+    }
+    append(compact ? "]}}" : "\n        ]\n      }\n    }");
+    flush_if_full();
+}
+
+void GeoJsonWriter::finish() {
+    if (finished_) {
+        return;
+    }
+    finished_ = true;
+    if (options_.compact) {
+        append("]}\n");
+    } else {
+        append(features_ > 0 ? "\n  ]\n}\n" : "  ]\n}\n");
+    }
+    flush();
+    stream_.close();
+    if (stream_.fail()) {
+        throw std::runtime_error("Failed to write GeoJSON output");
+    }
+}
+
+void GeoJsonWriter::append_number(double value, int precision) {
+    char text[64];
+    auto result = precision < 0 ? std::to_chars(text, text + sizeof(text), value, std::chars_format::general,
+                                                kDefaultSignificantDigits)
+                                : std::to_chars(text, text + sizeof(text), value, std::chars_format::fixed, precision);
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("Cannot format GeoJSON number");
+    }
+    buffer_.append(text, result.ptr);
+}
+
+void GeoJsonWriter::append_string(const std::string& value) {
+    buffer_.push_back('"');
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            buffer_.push_back('\\');
+            buffer_.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            static constexpr char kHex[] = "0123456789abcdef";
+            buffer_.append("\\u00");
+            buffer_.push_back(kHex[(c >> 4) & 0xF]);
+            buffer_.push_back(kHex[c & 0xF]);
+        } else {
+            buffer_.push_back(c);
+        }
+    }
+    buffer_.push_back('"');
+}
+
+void GeoJsonWriter::append_ring(const std::vector<GeoCoordinate>& ring) {
+    const bool compact = options_.compact;
+    append(compact ? "[" : "          [");
+    for (std::size_t p = 0; p < ring.size(); ++p) {
+        if (p > 0) {
+            append(compact ? "," : ", ");
+        }
+        buffer_.push_back('[');
+        append_number(ring[p].longitude_deg, options_.coordinate_precision);
+        append(compact ? "," : ", ");
+        append_number(ring[p].latitude_deg, options_.coordinate_precision);
+        buffer_.push_back(']');
+    }
+    buffer_.push_back(']');
+}
+
+void GeoJsonWriter::flush_if_full() {
+    if (buffer_.size() >= kFlushBytes) {
+        flush();
+    }
+}
+
+void GeoJsonWriter::flush() {
+    stream_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+}
+
+}  // namespace radar
@@ -1,6 +1,7 @@
 #include "radar/image_renderer.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdint>
 #include <fstream>
@@ -9,14 +10,14 @@
 #include <stdexcept>
 #include <vector>
 
+#include "radar/parallel.h"
+#include "radar/png_writer.h"
+#include "radar/scanline_fill.h"
+
 namespace radar {
 namespace {
 
-double clamp(double v, double lo, double hi) {
-    return std::max(lo, std::min(v, hi));
-}
-
-void write_bitmap(const std::vector<unsigned char>& buffer, std::size_t width, std::size_t height,
+void write_bitmap(std::span<const unsigned char> buffer, std::size_t width, std::size_t height,
                   const std::string& output_path) {
     std::ofstream out(output_path, std::ios::binary);
     if (!out) {
@@ -75,7 +76,7 @@ void ImageRenderer::render(const std::vector<MergedContour>& contours, const std
     std::vector<unsigned char> buffer(width * height * 3, 255);
 
     if (contours.empty()) {
-        write_bitmap(buffer, width, height, output_path);
+        write_image(buffer, options_, output_path);
         return;
     }
 
@@ -97,51 +98,19 @@ void ImageRenderer::render(const std::vector<MergedContour>& contours, const std
         throw std::runtime_error("Unable to determine contour bounds");
     }
 
-    double lat_span = max_lat - min_lat;
-    double lon_span = max_lon - min_lon;
-    const double lat_padding = std::max(lat_span * options_.padding_ratio, 1e-6);
-    const double lon_padding = std::max(lon_span * options_.padding_ratio, 1e-6);
-
-    min_lat -= lat_padding;
-    max_lat += lat_padding;
-    min_lon -= lon_padding;
-    max_lon += lon_padding;
-
-    lat_span = max_lat - min_lat;
-    lon_span = max_lon - min_lon;
-
-    auto x_to_lon = [&](std::size_t x) {
-        if (lon_span <= 0.0) {
-            return (min_lon + max_lon) * 0.5;
-        }
-        double ratio = (static_cast<double>(x) + 0.5) / static_cast<double>(width);
-        return min_lon + ratio * lon_span;
-    };
-
-    auto y_to_lat = [&](std::size_t y) {
-        if (lat_span <= 0.0) {
-            return (min_lat + max_lat) * 0.5;
-        }
-        double ratio = (static_cast<double>(y) + 0.5) / static_cast<double>(height);
-        return max_lat - ratio * lat_span;
-    };
-
-    auto lon_to_x_index = [&](double lon) {
-        if (lon_span <= 0.0 || width == 1) {
-            return 0.0;
-        }
-        double ratio = (lon - min_lon) / lon_span;
-        return clamp(ratio, 0.0, 1.0) * static_cast<double>(width - 1);
-    };
+    const double lat_padding = std::max((max_lat - min_lat) * options_.padding_ratio, 1e-6);
+    const double lon_padding = std::max((max_lon - min_lon) * options_.padding_ratio, 1e-6);
+    const Viewport view(min_lat - lat_padding, max_lat + lat_padding, min_lon - lon_padding, max_lon + lon_padding,
+                        width, height);
 
-    auto lat_to_y_index = [&](double lat) {
-        if (lat_span <= 0.0 || height == 1) {
-            return 0.0;
-        }
-        double ratio = (max_lat - lat) / lat_span;
-        return clamp(ratio, 0.0, 1.0) * static_cast<double>(height - 1);
+    // Pixel box and colour of every contour, in paint order.
+    struct Job {
+        const Polygon* polygon;
+        PixelBox box;
+        std::array<unsigned char, 3> bgr;
     };
-
+    std::vector<Job> jobs;
+    jobs.reserve(contours.size());
     for (const auto& contour : contours) {
         if (contour.geometry.vertices.empty()) {
             continue;
@@ -159,59 +128,65 @@ void ImageRenderer::render(const std::vector<MergedContour>& contours, const std
             contour_max_lon = std::max(contour_max_lon, vertex.longitude_deg);
         }
 
-        int min_x = static_cast<int>(std::floor(lon_to_x_index(contour_min_lon)));
-        int max_x = static_cast<int>(std::ceil(lon_to_x_index(contour_max_lon)));
-        int min_y = static_cast<int>(std::floor(lat_to_y_index(contour_max_lat)));
-        int max_y = static_cast<int>(std::ceil(lat_to_y_index(contour_min_lat)));
+        PixelBox box;
+        box.min_x = static_cast<int>(std::floor(view.lon_to_x_index(contour_min_lon)));
+        box.max_x = static_cast<int>(std::ceil(view.lon_to_x_index(contour_max_lon)));
+        box.min_y = static_cast<int>(std::floor(view.lat_to_y_index(contour_max_lat)));
+        box.max_y = static_cast<int>(std::ceil(view.lat_to_y_index(contour_min_lat)));
 
-        min_x = std::clamp(min_x, 0, static_cast<int>(width) - 1);
-        max_x = std::clamp(max_x, 0, static_cast<int>(width) - 1);
-        min_y = std::clamp(min_y, 0, static_cast<int>(height) - 1);
-        max_y = std::clamp(max_y, 0, static_cast<int>(height) - 1);
+        box.min_x = std::clamp(box.min_x, 0, static_cast<int>(width) - 1);
+        box.max_x = std::clamp(box.max_x, 0, static_cast<int>(width) - 1);
+        box.min_y = std::clamp(box.min_y, 0, static_cast<int>(height) - 1);
+        box.max_y = std::clamp(box.max_y, 0, static_cast<int>(height) - 1);
 
         const unsigned rgba = rgba_from_string(contour.phenomenon_type);
         const unsigned char r = static_cast<unsigned char>((rgba >> 24) & 0xFF);
         const unsigned char g = static_cast<unsigned char>((rgba >> 16) & 0xFF);
         const unsigned char b = static_cast<unsigned char>((rgba >> 8) & 0xFF);
 
-        for (int y = min_y; y <= max_y; ++y) {
-            const double lat = y_to_lat(static_cast<std::size_t>(y));
-            for (int x = min_x; x <= max_x; ++x) {
-                const double lon = x_to_lon(static_cast<std::size_t>(x));
-                if (point_in_polygon(lat, lon, contour.geometry)) {
-                    auto* pixel = &buffer[3 * (y * static_cast<int>(width) + x)];
-                    pixel[0] = b;
-                    pixel[1] = g;
-                    pixel[2] = r;
-                }
-            }
+        jobs.push_back(Job{&contour.geometry, box, {b, g, r}});
+    }
+
+    // Horizontal bands are painted independently; within a band contours keep their order, so
+    // the image is the same as a sequential pass for any thread count. Several bands per thread
+    // even out the load where storms cluster in part of the map.
+    const std::size_t threads = resolve_thread_count(options_.threads);
+    const std::size_t band_count = std::min(height, threads == 1 ? std::size_t{1} : threads * 4);
+    const std::size_t band_rows = (height + band_count - 1) / band_count;
+    std::vector<std::vector<std::uint32_t>> band_jobs(band_count);
+    for (std::size_t j = 0; j < jobs.size(); ++j) {
+        const auto& box = jobs[j].box;
+        for (std::size_t band = static_cast<std::size_t>(box.min_y) / band_rows;
+             band <= static_cast<std::size_t>(box.max_y) / band_rows; ++band) {
+            band_jobs[band].push_back(static_cast<std::uint32_t>(j));
         }
     }
 
-    write_bitmap(buffer, width, height, output_path);
+    parallel_for(band_count, threads, 1, [&](std::size_t first_band, std::size_t last_band) {
+        ScanlineFiller filler(view, buffer.data());
+        for (std::size_t band = first_band; band < last_band; ++band) {
+            const int band_top = static_cast<int>(band * band_rows);
+            const int band_bottom = static_cast<int>(std::min(height, (band + 1) * band_rows)) - 1;
+            for (std::uint32_t j : band_jobs[band]) {
+                PixelBox box = jobs[j].box;
+                box.min_y = std::max(box.min_y, band_top);
+                box.max_y = std::min(box.max_y, band_bottom);
+                filler.fill(*jobs[j].polygon, box, jobs[j].bgr);
+            }
+        }
+    });
+
+    write_image(buffer, options_, output_path);
 }
 
-bool ImageRenderer::point_in_polygon(double lat, double lon, const Polygon& polygon) {
-    bool inside = false;
-    const std::size_t n = polygon.vertices.size();
-    if (n < 3) {
-        return false;
-    }
-    for (std::size_t i = 0, j = n - 1; i < n; j = i++) {
-        const auto& vi = polygon.vertices[i];
-        const auto& vj = polygon.vertices[j];
-        const double xi = vi.longitude_deg;
-        const double yi = vi.latitude_deg;
-        const double xj = vj.longitude_deg;
-        const double yj = vj.latitude_deg;
-
-        const bool intersect = ((yi > lat) != (yj > lat)) &&
-                               (lon < (xj - xi) * (lat - yi) / (yj - yi + 1e-12) + xi);
-        if (intersect) {
-            inside = !inside;
-        }
+void ImageRenderer::write_image(std::span<const unsigned char> bgr, const ImageRenderOptions& options,
+                                const std::string& output_path) {
+    if (options.format == ImageFormat::Png) {
+        write_png(bgr, options.width, options.height, output_path,
+                  PngOptions{.palette = options.palette, .threads = options.threads});
+    } else {
+        write_bitmap(bgr, options.width, options.height, output_path);
     }
-    return inside;
 }
 
 unsigned ImageRenderer::rgba_from_string(const std::string& key) {
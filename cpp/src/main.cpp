@@ -3,16 +3,22 @@
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <optional>
 #include <unordered_map>
 
 #include "radar/bufr_decoder.h"
+#include "radar/cell_assembler.h"
 #include "radar/cell_grid.h"
 #include "radar/cluster_analyzer.h"
 #include "radar/config.h"
+#include "radar/contour_file.h"
 #include "radar/contour_merger.h"
+#include "radar/contour_simplifier.h"
 #include "radar/echo_tops.h"
 #include "radar/geo_utils.h"
 #include "radar/image_renderer.h"
+#include "radar/reflectivity_renderer.h"
+#include "radar/tile_renderer.h"
 
 namespace fs = std::filesystem;
 
@@ -27,74 +33,92 @@ int main(int argc, char** argv) {
     try {
         auto config = ConfigLoader::load_pipeline(argv[1]);
         auto tables = ConfigLoader::load_tables(config.tables_path);
+        std::unordered_map<std::string, std::vector<std::string>> sequences;
+        if (!config.sequence_tables_path.empty()) {
+            sequences = ConfigLoader::load_sequences(config.sequence_tables_path);
+        }
 
-        BufrDecoder decoder(std::move(tables));
-        auto messages = decoder.decode_file(config.bufr_input);
+        BufrDecoder decoder(std::move(tables), std::move(sequences), BufrDecoderOptions{
+            .threads = config.decode_threads,
+            .layout = config.bufr_layout,
+        });
 
         GeoCalculator geo(config.radar_latitude, config.radar_longitude, config.radar_altitude_m);
         EchoTops echo_tops;
         echo_tops.load(config.echo_tops_matrix);
 
-        CellGrid grid;
+        CellGrid grid(geo, config.grid_cell_size_km);
         fs::create_directories(config.csv_output_dir);
         std::ofstream csv(config.csv_output_dir + "/cells.csv");
         csv << "row,column,reflectivity_dbz,velocity_ms,spectrum_width,echo_top_km,phenomenon,center_lat,center_lon\n";
 
-        for (const auto& message : messages) {
-            std::unordered_map<std::string, double> numeric;
-            for (const auto& value : message.values) {
-                numeric[value.mnemonic] = value.value;
-            }
-            if (!numeric.count("ROW") || !numeric.count("COLUMN") || !numeric.count("DBZH")) {
-                continue;
-            }
-            CellData cell;
-            cell.row = static_cast<int>(numeric["ROW"]);
-            cell.column = static_cast<int>(numeric["COLUMN"]);
-            cell.reflectivity_dbz = numeric["DBZH"];
-            cell.velocity_ms = numeric.count("VRAD") ? numeric["VRAD"] : 0.0;
-            cell.spectrum_width = numeric.count("SWRAD") ? numeric["SWRAD"] : 0.0;
-            RadarObservation obs{
-                .azimuth_deg = numeric.count("AZIMUTH") ? numeric["AZIMUTH"] : 0.0,
-                .range_km = numeric.count("RANGE") ? numeric["RANGE"] : 0.0,
-                .elevation_deg = numeric.count("ELEVATION") ? numeric["ELEVATION"] : 0.0,
-            };
-            cell.geometry = geo.compute_geometry(obs, config.grid_cell_size_km);
-            cell.echo_top_km = echo_tops.value(cell.row, cell.column);
-            if (numeric.count("PHENOMENON")) {
-                cell.phenomenon_type = std::to_string(static_cast<int>(numeric["PHENOMENON"]));
-            }
-
-            bool allowed = config.allowed_phenomena.empty();
-            if (!config.allowed_phenomena.empty()) {
-                allowed = std::find(config.allowed_phenomena.begin(), config.allowed_phenomena.end(), cell.phenomenon_type) != config.allowed_phenomena.end();
-            }
-            if (!allowed) {
-                continue;
-            }
-            double min_threshold = config.reflectivity_thresholds.empty() ? -std::numeric_limits<double>::infinity()
-                                                                         : config.reflectivity_thresholds.front();
-            if (cell.reflectivity_dbz < min_threshold) {
-                continue;
-            }
+        CellAssembler assembler(decoder, echo_tops, CellAssemblyOptions{
+            .min_reflectivity_dbz = config.reflectivity_thresholds.empty()
+                                        ? -std::numeric_limits<double>::infinity()
+                                        : *std::min_element(config.reflectivity_thresholds.begin(),
+                                                            config.reflectivity_thresholds.end()),
+            .allowed_phenomena = config.allowed_phenomena,
+        });
+
+        // Every gate, before the filters, for the reflectivity image: its layout and colours
+        // cover the whole volume rather than the echo above the lowest threshold.
+        std::optional<CellGrid> volume;
+        if (!config.reflectivity_image_path.empty()) {
+            volume.emplace(geo, config.grid_cell_size_km);
+        }
 
-            grid.add_cell(cell);
-            csv << cell.row << ',' << cell.column << ',' << cell.reflectivity_dbz << ',' << cell.velocity_ms << ','
-                << cell.spectrum_width << ',';
-            if (cell.echo_top_km.has_value()) {
-                csv << cell.echo_top_km.value();
+        // Cells are built as messages stream out of the decoder; the decoded file is never held.
+        auto message_count = decoder.decode_file(config.bufr_input, [&](const BufrMessageView& message) {
+            assembler.split(message, [&](const GateRecord& record) {
+                CellData cell;
+                if (!assembler.build(record, cell)) {
+                    return;
+                }
+                if (volume) {
+                    volume->add_cell(cell);
+                }
+                if (!assembler.accepts(cell)) {
+                    return;
+                }
+                csv << cell.row << ',' << cell.column << ',' << cell.reflectivity_dbz << ',' << cell.velocity_ms << ','
+                    << cell.spectrum_width << ',';
+                if (cell.echo_top_km.has_value()) {
+                    csv << cell.echo_top_km.value();
+                }
+                const auto center = geo.compute_center(cell.observation);
+                csv << ',' << cell.phenomenon_type << ',' << center.latitude_deg << ',' << center.longitude_deg << '\n';
+                grid.add_cell(cell);
+            });
+        });
+
+        ClusterAnalyzer analyzer(grid, ClusterOptions{.threads = config.cluster_threads});
+        auto thresholds = config.reflectivity_thresholds.empty() ? std::vector<double>{35.0} : config.reflectivity_thresholds;
+        auto tree = analyzer.build_cluster_tree(thresholds);
+
+        // Contours are merged within a level only; levels nest, lowest threshold first.
+        ContourMerger merger(ContourMergeOptions{.mode = config.contour_mode});
+        std::vector<MergedContour> merged;
+        for (const auto& level : tree) {
+            for (auto& contour : merger.merge(grid, level)) {
+                contour.threshold_dbz = level.threshold_dbz;
+                merged.push_back(std::move(contour));
             }
-            csv << ',' << cell.phenomenon_type << ',' << cell.geometry.center.latitude_deg << ','
-                << cell.geometry.center.longitude_deg << '\n';
         }
-
-        ClusterAnalyzer analyzer(grid);
-        double threshold = config.reflectivity_thresholds.empty() ? 35.0 : config.reflectivity_thresholds.front();
-        auto clusters = analyzer.find_clusters(threshold);
-
-        ContourMerger merger;
-        auto merged = merger.merge(clusters);
-        merger.write_geojson(merged, config.merged_geojson_output);
+        if (config.simplify_tolerance_km > 0.0) {
+            ContourSimplifier simplifier(SimplifyOptions{.tolerance_km = config.simplify_tolerance_km});
+            auto stats = simplifier.simplify(merged);
+            std::cout << "Simplified contours: removed " << stats.removed() << " of " << stats.vertices_before
+                      << " vertices" << std::endl;
+        }
+        if (config.contour_output_format != ContourOutputFormat::Binary) {
+            merger.write_geojson(merged, config.merged_geojson_output, GeoJsonOptions{
+                .coordinate_precision = config.geojson_precision,
+                .compact = config.geojson_compact,
+            });
+        }
+        if (config.contour_output_format != ContourOutputFormat::GeoJson) {
+            ContourFileWriter::write(merged, config.merged_binary_output);
+        }
 
         if (!config.image_output_path.empty()) {
             if (!fs::path(config.image_output_path).parent_path().empty()) {
@@ -103,15 +127,54 @@ int main(int argc, char** argv) {
             ImageRenderer renderer(ImageRenderOptions{
                 .width = config.image_width,
                 .height = config.image_height,
+                .threads = config.render_threads,
+                .format = config.image_format,
+                .palette = config.image_palette,
             });
             renderer.render(merged, config.image_output_path);
         }
 
-        std::cout << "Processed " << messages.size() << " BUFR messages" << std::endl;
+        if (!config.reflectivity_image_path.empty()) {
+            if (!fs::path(config.reflectivity_image_path).parent_path().empty()) {
+                fs::create_directories(fs::path(config.reflectivity_image_path).parent_path());
+            }
+            ReflectivityRenderer reflectivity(*volume, ReflectivityRenderOptions{
+                .width = config.image_width,
+                .height = config.image_height,
+                .radar_latitude_deg = config.radar_latitude,
+                .radar_longitude_deg = config.radar_longitude,
+                .max_range_km = config.reflectivity_max_range_km,
+                .threads = config.render_threads,
+                .format = config.image_format,
+                .palette = config.image_palette,
+            });
+            reflectivity.render(*volume, config.reflectivity_image_path);
+        }
+
+        TileStats tiles;
+        if (!config.tile_output_dir.empty()) {
+            TileRenderer tiler(config.tile_output_dir, TileOptions{
+                .min_zoom = config.tile_min_zoom,
+                .max_zoom = config.tile_max_zoom,
+                .threads = config.render_threads,
+                .palette = config.image_palette,
+            });
+            tiles = tiler.render(merged);
+        }
+
+        std::cout << "Processed " << message_count << " BUFR messages" << std::endl;
         std::cout << "Generated " << merged.size() << " merged contours" << std::endl;
         if (!config.image_output_path.empty()) {
             std::cout << "Rendered contour map to " << config.image_output_path << std::endl;
         }
+        if (!config.reflectivity_image_path.empty()) {
+            std::cout << "Rendered reflectivity to " << config.reflectivity_image_path << std::endl;
+        }
+        if (!config.tile_output_dir.empty()) {
+            std::cout << "Tiles: " << tiles.tiles << " in zoom " << config.tile_min_zoom << "-" << config.tile_max_zoom
+                      << ", wrote " << tiles.written << ", unchanged " << tiles.unchanged << ", removed "
+                      << tiles.removed << std::endl;
+        }
     } catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << std::endl;
         return 1;
@@ -0,0 +1,125 @@
+#include "radar/mapped_file.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RADAR_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace radar {
+namespace {
+
+constexpr std::size_t kChunkSize = 1 << 20;
+
+#ifdef RADAR_HAVE_MMAP
+// Drains an already-open descriptor; pipes and FIFOs cannot be reopened once read from.
+std::vector<std::uint8_t> read_descriptor(int fd, const std::filesystem::path& path) {
+    std::vector<std::uint8_t> data;
+    while (true) {
+        std::size_t offset = data.size();
+        data.resize(offset + kChunkSize);
+        ssize_t count = ::read(fd, data.data() + offset, kChunkSize);
+        if (count < 0) {
+            throw std::runtime_error("Failed to read input file: " + path.string());
+        }
+        data.resize(offset + static_cast<std::size_t>(count));
+        if (count == 0) {
+            return data;
+        }
+    }
+}
+#else
+std::vector<std::uint8_t> read_stream(const std::filesystem::path& path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream.is_open()) {
+        throw std::runtime_error("Cannot open input file: " + path.string());
+    }
+    std::vector<std::uint8_t> data;
+    while (stream) {
+        std::size_t offset = data.size();
+        data.resize(offset + kChunkSize);
+        stream.read(reinterpret_cast<char*>(data.data() + offset), static_cast<std::streamsize>(kChunkSize));
+        data.resize(offset + static_cast<std::size_t>(stream.gcount()));
+    }
+    return data;
+}
+#endif
+
+}  // namespace
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+#ifdef RADAR_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open input file: " + path.string());
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        auto size = static_cast<std::size_t>(info.st_size);
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            ::madvise(mapping, size, MADV_SEQUENTIAL);
+            mapping_ = mapping;
+            mapping_size_ = size;
+            bytes_ = std::span<const std::uint8_t>(static_cast<const std::uint8_t*>(mapping), size);
+        }
+    }
+    if (mapping_ == nullptr) {
+        try {
+            fallback_ = read_descriptor(fd, path);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        bytes_ = fallback_;
+    }
+    ::close(fd);
+#else
+    fallback_ = read_stream(path);
+    bytes_ = fallback_;
+#endif
+}
+
+MappedFile::~MappedFile() { release(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : mapping_(std::exchange(other.mapping_, nullptr)),
+      mapping_size_(std::exchange(other.mapping_size_, 0)),
+      fallback_(std::move(other.fallback_)),
+      bytes_(std::exchange(other.bytes_, {})) {
+    if (mapping_ == nullptr) {
+        bytes_ = fallback_;
+    }
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        release();
+        mapping_ = std::exchange(other.mapping_, nullptr);
+        mapping_size_ = std::exchange(other.mapping_size_, 0);
+        fallback_ = std::move(other.fallback_);
+        bytes_ = std::exchange(other.bytes_, {});
+        if (mapping_ == nullptr) {
+            bytes_ = fallback_;
+        }
+    }
+    return *this;
+}
+
+void MappedFile::release() {
+#ifdef RADAR_HAVE_MMAP
+    if (mapping_ != nullptr) {
+        ::munmap(mapping_, mapping_size_);
+    }
+#endif
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+}
+
+}  // namespace radar
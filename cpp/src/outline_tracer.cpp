@@ -0,0 +1,149 @@
+#include "radar/outline_tracer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+namespace radar {
+
+namespace {
+
+constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+
+// Directions on the lattice with columns along x and rows along y, in counter-clockwise order.
+enum Direction : std::uint8_t { East, North, West, South };
+
+// One side of a cell on a cluster boundary, directed so the cell lies to its left.
+struct Crack {
+    std::uint32_t cell = 0;
+    std::uint8_t corner = 0;  // index into CellGeometry::vertices of the start point
+    Direction direction = East;
+    std::int64_t row = 0;  // lattice start point
+    std::int64_t column = 0;
+};
+
+std::uint64_t lattice_key(std::int64_t row, std::int64_t column) {
+    return (static_cast<std::uint64_t>(row) << 32) ^ static_cast<std::uint32_t>(column);
+}
+
+// Start of each side of cell (r, c) and the CellGeometry vertex sitting there. compute_geometry()
+// lists the far corners (column + 1 side) first, lower azimuth (row - 1 side) before higher,
+// then the near corners in the same order.
+struct Side {
+    int row_step;  // neighbour across this side
+    int column_step;
+    Direction direction;
+    int start_row;  // start point relative to (r, c)
+    int start_column;
+    std::uint8_t corner;
+};
+constexpr std::array<Side, 4> kSides = {{
+    {-1, 0, East, 0, 0, 2},
+    {0, 1, North, 0, 1, 0},
+    {1, 0, West, 1, 1, 1},
+    {0, -1, South, 1, 0, 3},
+}};
+
+double signed_area(const std::vector<GeoCoordinate>& ring) {
+    double twice_area = 0.0;
+    for (std::size_t i = 0; i + 1 < ring.size(); ++i) {
+        twice_area += ring[i].longitude_deg * ring[i + 1].latitude_deg - ring[i + 1].longitude_deg * ring[i].latitude_deg;
+    }
+    return twice_area / 2.0;
+}
+
+}  // namespace
+
+OutlineTracer::OutlineTracer(const CellGrid& grid) : grid_(grid) {}
+
+std::vector<Polygon> OutlineTracer::trace(const ClusterSet& clusters) const {
+    std::vector<std::uint32_t> label(grid_.size(), kNone);
+    for (std::size_t c = 0; c < clusters.clusters.size(); ++c) {
+        for (auto index : clusters.members_of(clusters.clusters[c])) {
+            label[index] = static_cast<std::uint32_t>(c);
+        }
+    }
+
+    // Every side a member shares with a non-member. Distinct clusters never touch, not even at a
+    // corner, so each lattice point starts cracks of one cluster only: one, or two where two
+    // diagonal cells meet.
+    const auto rows = grid_.rows();
+    const auto columns = grid_.columns();
+    std::vector<Crack> cracks;
+    std::unordered_map<std::uint64_t, std::array<std::uint32_t, 2>> starts;
+    for (std::size_t index = 0; index < label.size(); ++index) {
+        if (label[index] == kNone) {
+            continue;
+        }
+        for (const auto& side : kSides) {
+            auto neighbour = grid_.index_of(rows[index] + side.row_step, columns[index] + side.column_step);
+            if (neighbour != CellGrid::npos && label[neighbour] == label[index]) {
+                continue;
+            }
+            Crack crack{static_cast<std::uint32_t>(index), side.corner, side.direction,
+                        std::int64_t{rows[index]} + side.start_row, std::int64_t{columns[index]} + side.start_column};
+            auto& slots = starts.try_emplace(lattice_key(crack.row, crack.column), std::array{kNone, kNone}).first->second;
+            slots[slots[0] == kNone ? 0 : 1] = static_cast<std::uint32_t>(cracks.size());
+            cracks.push_back(crack);
+        }
+    }
+
+    std::vector<Polygon> polygons(clusters.clusters.size());
+    std::vector<bool> visited(cracks.size(), false);
+    // Consecutive cracks mostly belong to one cell, so its geometry is kept between them.
+    std::uint32_t geometry_cell = kNone;
+    CellGeometry geometry;
+    std::vector<GeoCoordinate> ring;
+    for (std::size_t first = 0; first < cracks.size(); ++first) {
+        if (visited[first]) {
+            continue;
+        }
+        ring.clear();
+        // Twice the signed area in lattice units, relative to the first point to keep it small.
+        std::int64_t lattice_area = 0;
+        const std::int64_t origin_row = cracks[first].row;
+        const std::int64_t origin_column = cracks[first].column;
+        auto current = static_cast<std::uint32_t>(first);
+        while (!visited[current]) {
+            visited[current] = true;
+            const auto& crack = cracks[current];
+            if (crack.cell != geometry_cell) {
+                geometry_cell = crack.cell;
+                geometry = grid_.geometry(crack.cell);
+            }
+            ring.push_back(geometry.vertices[crack.corner]);
+            const std::int64_t end_row = crack.row + (crack.direction == North) - (crack.direction == South);
+            const std::int64_t end_column = crack.column + (crack.direction == East) - (crack.direction == West);
+            lattice_area += (crack.column - origin_column) * (end_row - origin_row) -
+                            (end_column - origin_column) * (crack.row - origin_row);
+
+            const auto& next = starts.at(lattice_key(end_row, end_column));
+            current = next[0];
+            if (next[1] != kNone) {
+                // Where diagonal members meet, turn right so they stay on one ring, matching the
+                // 8-connectivity of the clusters.
+                const auto right = static_cast<Direction>((crack.direction + 3) % 4);
+                current = cracks[next[0]].direction == right ? next[0] : next[1];
+            }
+        }
+        ring.push_back(ring.front());
+
+        auto& polygon = polygons[label[cracks[first].cell]];
+        const bool outer = lattice_area > 0;
+        // The lattice maps onto the map mirrored (azimuth runs clockwise), so orientation is
+        // checked on the coordinates themselves.
+        if ((signed_area(ring) > 0.0) != outer) {
+            std::reverse(ring.begin(), ring.end());
+        }
+        if (outer) {
+            polygon.vertices = ring;
+        } else {
+            polygon.holes.push_back(ring);
+        }
+    }
+    return polygons;
+}
+
+}  // namespace radar
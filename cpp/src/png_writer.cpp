@@ -0,0 +1,224 @@
+#include "radar/png_writer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "radar/deflate.h"
+#include "radar/parallel.h"
+
+namespace radar {
+namespace {
+
+constexpr std::size_t kBlockBytes = 256 * 1024;  // filtered bytes per independently deflated block
+constexpr std::size_t kMaxIdatBytes = 1 << 20;
+
+void put_u32(std::vector<std::uint8_t>& out, std::uint32_t value) {
+    out.push_back(static_cast<std::uint8_t>(value >> 24));
+    out.push_back(static_cast<std::uint8_t>(value >> 16));
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+void put_chunk(std::vector<std::uint8_t>& out, const char (&type)[5], std::span<const std::uint8_t> data) {
+    put_u32(out, static_cast<std::uint32_t>(data.size()));
+    const std::size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_u32(out, crc32(std::span<const std::uint8_t>(out).subspan(start)));
+}
+
+std::uint32_t pixel_at(std::span<const std::uint8_t> bgr, std::size_t index) {
+    const std::uint8_t* p = bgr.data() + 3 * index;
+    return (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[1]) << 8) | p[0];
+}
+
+// Colours in order of first appearance, or empty when there are more than 256.
+std::vector<std::uint32_t> collect_palette(std::span<const std::uint8_t> bgr, std::size_t pixels) {
+    std::vector<std::uint32_t> palette;
+    std::uint32_t last = std::numeric_limits<std::uint32_t>::max();
+    for (std::size_t i = 0; i < pixels; ++i) {
+        const std::uint32_t colour = pixel_at(bgr, i);
+        if (colour == last) {
+            continue;
+        }
+        last = colour;
+        if (std::find(palette.begin(), palette.end(), colour) == palette.end()) {
+            if (palette.size() == 256) {
+                return {};
+            }
+            palette.push_back(colour);
+        }
+    }
+    return palette;
+}
+
+std::uint8_t paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return static_cast<std::uint8_t>(a);
+    }
+    return static_cast<std::uint8_t>(pb <= pc ? b : c);
+}
+
+// Appends the filter type and filtered bytes of one truecolour row, picking the filter with the
+// smallest sum of absolute signed residuals.
+void filter_row(const std::uint8_t* row, const std::uint8_t* above, std::size_t length, std::vector<std::uint8_t>& out,
+                std::vector<std::uint8_t>& scratch) {
+    constexpr std::size_t kBpp = 3;
+    scratch.resize(5 * length);
+    std::uint64_t best_cost = std::numeric_limits<std::uint64_t>::max();
+    std::size_t best = 0;
+    for (std::size_t type = 0; type < 5; ++type) {
+        if (above == nullptr && (type == 2 || type == 4)) {
+            continue;  // same as Sub / None on the first row
+        }
+        std::uint8_t* filtered = scratch.data() + type * length;
+        std::uint64_t cost = 0;
+        for (std::size_t i = 0; i < length; ++i) {
+            const int a = i >= kBpp ? row[i - kBpp] : 0;
+            const int b = above != nullptr ? above[i] : 0;
+            const int c = above != nullptr && i >= kBpp ? above[i - kBpp] : 0;
+            int predicted = 0;
+            switch (type) {
+            case 1: predicted = a; break;
+            case 2: predicted = b; break;
+            case 3: predicted = (a + b) / 2; break;
+            case 4: predicted = paeth(a, b, c); break;
+            default: break;
+            }
+            filtered[i] = static_cast<std::uint8_t>(row[i] - predicted);
+            cost += static_cast<std::uint64_t>(std::abs(static_cast<int>(static_cast<std::int8_t>(filtered[i]))));
+        }
+        if (cost < best_cost) {
+            best_cost = cost;
+            best = type;
+        }
+    }
+    out.push_back(static_cast<std::uint8_t>(best));
+    out.insert(out.end(), scratch.data() + best * length, scratch.data() + (best + 1) * length);
+}
+
+}  // namespace
+
+std::vector<std::uint8_t> encode_png(std::span<const std::uint8_t> bgr, std::size_t width, std::size_t height,
+                                     const PngOptions& options) {
+    if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF) {
+        throw std::invalid_argument("Invalid PNG dimensions");
+    }
+    if (bgr.size() < width * height * 3) {
+        throw std::invalid_argument("PNG pixel buffer too small");
+    }
+
+    const auto palette = options.palette ? collect_palette(bgr, width * height) : std::vector<std::uint32_t>{};
+    const bool indexed = !palette.empty();
+    const std::size_t row_bytes = indexed ? width : width * 3;
+    const std::size_t rows_per_block = std::max<std::size_t>(1, kBlockBytes / (row_bytes + 1));
+    const std::size_t blocks = (height + rows_per_block - 1) / rows_per_block;
+
+    // Truecolour rows become RGB; indexed rows are palette indices, left unfiltered as the PNG
+    // spec recommends for palette images.
+    auto convert_row = [&](std::size_t y, std::uint8_t* out) {
+        const std::uint8_t* src = bgr.data() + 3 * y * width;
+        if (!indexed) {
+            for (std::size_t x = 0; x < width; ++x) {
+                out[3 * x] = src[3 * x + 2];
+                out[3 * x + 1] = src[3 * x + 1];
+                out[3 * x + 2] = src[3 * x];
+            }
+            return;
+        }
+        std::uint32_t last_colour = palette[0];
+        std::uint8_t last_index = 0;
+        for (std::size_t x = 0; x < width; ++x) {
+            const std::uint32_t colour = pixel_at(bgr, y * width + x);
+            if (colour != last_colour) {
+                last_colour = colour;
+                last_index = static_cast<std::uint8_t>(std::find(palette.begin(), palette.end(), colour) - palette.begin());
+            }
+            out[x] = last_index;
+        }
+    };
+
+    std::vector<std::vector<std::uint8_t>> compressed(blocks);
+    std::vector<std::uint32_t> checksums(blocks);
+    std::vector<std::size_t> lengths(blocks);
+    parallel_for(blocks, options.threads, 1, [&](std::size_t first_block, std::size_t last_block) {
+        std::vector<std::uint8_t> filtered;
+        std::vector<std::uint8_t> current(row_bytes);
+        std::vector<std::uint8_t> above(row_bytes);
+        std::vector<std::uint8_t> scratch;
+        for (std::size_t block = first_block; block < last_block; ++block) {
+            const std::size_t begin = block * rows_per_block;
+            const std::size_t end = std::min(height, begin + rows_per_block);
+            filtered.clear();
+            filtered.reserve((end - begin) * (row_bytes + 1));
+            if (!indexed && begin > 0) {
+                convert_row(begin - 1, above.data());
+            }
+            for (std::size_t y = begin; y < end; ++y) {
+                convert_row(y, current.data());
+                if (indexed) {
+                    filtered.push_back(0);
+                    filtered.insert(filtered.end(), current.begin(), current.end());
+                } else {
+                    filter_row(current.data(), y > 0 ? above.data() : nullptr, row_bytes, filtered, scratch);
+                    std::swap(current, above);
+                }
+            }
+            deflate_compress(filtered, block + 1 == blocks, compressed[block]);
+            checksums[block] = adler32(filtered);
+            lengths[block] = filtered.size();
+        }
+    });
+
+    std::vector<std::uint8_t> zlib = {0x78, 0x9C};
+    std::uint32_t adler = 1;
+    for (std::size_t block = 0; block < blocks; ++block) {
+        zlib.insert(zlib.end(), compressed[block].begin(), compressed[block].end());
+        adler = adler32_combine(adler, checksums[block], lengths[block]);
+    }
+    put_u32(zlib, adler);
+
+    std::vector<std::uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<std::uint8_t> header;
+    put_u32(header, static_cast<std::uint32_t>(width));
+    put_u32(header, static_cast<std::uint32_t>(height));
+    header.insert(header.end(), {8, static_cast<std::uint8_t>(indexed ? 3 : 2), 0, 0, 0});
+    put_chunk(png, "IHDR", header);
+    if (indexed) {
+        std::vector<std::uint8_t> entries;
+        for (auto colour : palette) {
+            entries.insert(entries.end(), {static_cast<std::uint8_t>(colour >> 16), static_cast<std::uint8_t>(colour >> 8),
+                                           static_cast<std::uint8_t>(colour)});
+        }
+        put_chunk(png, "PLTE", entries);
+    }
+    for (std::size_t offset = 0; offset < zlib.size(); offset += kMaxIdatBytes) {
+        put_chunk(png, "IDAT",
+                  std::span<const std::uint8_t>(zlib).subspan(offset, std::min(kMaxIdatBytes, zlib.size() - offset)));
+    }
+    put_chunk(png, "IEND", {});
+    return png;
+}
+
+void write_png(std::span<const std::uint8_t> bgr, std::size_t width, std::size_t height,
+               const std::string& output_path, const PngOptions& options) {
+    const auto png = encode_png(bgr, width, height, options);
+    std::ofstream out(output_path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Failed to open image output for writing");
+    }
+    out.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Failed to write image output");
+    }
+}
+
+}  // namespace radar
@@ -0,0 +1,350 @@
+#include "radar/reflectivity_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "radar/parallel.h"
+
+namespace radar {
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kEarthRadiusKm = 6371.0;
+constexpr int kAzimuthBins = 3600;  // 0.1 degree
+constexpr int kRangeBinsPerGate = 8;
+constexpr float kMaxStep = 254.0f;  // highest table index is 1 + 254
+
+struct Stop {
+    float dbz;
+    std::uint32_t rgb;
+};
+
+constexpr Stop kStandardStops[] = {
+    {5.0f, 0x04E9E7},  {10.0f, 0x019FF4}, {15.0f, 0x0300F4}, {20.0f, 0x02FD02}, {25.0f, 0x01C501},
+    {30.0f, 0x008E00}, {35.0f, 0xFDF802}, {40.0f, 0xE5BC00}, {45.0f, 0xFD9500}, {50.0f, 0xFD0000},
+    {55.0f, 0xD40000}, {60.0f, 0xBC0000}, {65.0f, 0xF800FD}, {70.0f, 0x9854C6}, {75.0f, 0xFDFDFD},
+};
+constexpr std::uint32_t kBackground = 0xFFFFFF;
+
+void colour_scalar(const std::uint32_t* gates, std::size_t count, const float* dbz, const ReflectivityLut& lut,
+                   unsigned char* bgr) {
+    for (std::size_t p = 0; p < count; ++p) {
+        const std::uint32_t gate = gates[p];
+        const std::uint8_t index = gate == kNoGate ? 0 : lut.index(dbz[gate]);
+        std::memcpy(bgr + 3 * p, &lut.bgrx[index], 3);  // little-endian: B, G, R
+    }
+}
+
+#if defined(__AVX2__)
+void colour_avx2(const std::uint32_t* gates, std::size_t count, const float* dbz, const ReflectivityLut& lut,
+                 unsigned char* bgr) {
+    const __m256i no_gate = _mm256_set1_epi32(-1);
+    const __m256 nan = _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+    const __m256 min_dbz = _mm256_set1_ps(lut.min_dbz);
+    const __m256 inv_step = _mm256_set1_ps(1.0f / lut.step_dbz);
+    const __m256 max_step = _mm256_set1_ps(kMaxStep);
+    const __m256i one = _mm256_set1_epi32(1);
+    // BGRX -> BGR inside each lane, then the two 12-byte halves moved together.
+    const __m256i pack_lanes = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,  //
+                                                0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i join_lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    const auto* table = reinterpret_cast<const int*>(lut.bgrx.data());
+
+    std::size_t p = 0;
+    for (; p + 8 <= count; p += 8) {
+        const __m256i gate = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(gates + p));
+        const __m256 present = _mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpeq_epi32(gate, no_gate), no_gate));
+        const __m256 value = _mm256_mask_i32gather_ps(nan, dbz, gate, present, 4);
+
+        // Same arithmetic as ReflectivityLut::index(): NaN and values below the table fail the
+        // ordered compare and fall to entry 0.
+        const __m256 valid = _mm256_cmp_ps(value, min_dbz, _CMP_GE_OQ);
+        const __m256 steps = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(value, min_dbz), inv_step), max_step);
+        __m256i index = _mm256_add_epi32(_mm256_cvttps_epi32(steps), one);
+        index = _mm256_and_si256(index, _mm256_castps_si256(valid));
+
+        __m256i colour = _mm256_i32gather_epi32(table, index, 4);
+        colour = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(colour, pack_lanes), join_lanes);
+        unsigned char* out = bgr + 3 * p;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(colour));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), _mm256_extracti128_si256(colour, 1));
+    }
+    colour_scalar(gates + p, count - p, dbz, lut, bgr + 3 * p);
+}
+#endif
+
+double bearing_deg(double east_km, double north_km) {
+    double bearing = std::atan2(east_km, north_km) * 180.0 / kPi;
+    return bearing < 0.0 ? bearing + 360.0 : bearing;
+}
+
+}  // namespace
+
+ReflectivityLut ReflectivityLut::standard() {
+    ReflectivityLut lut;
+    lut.bgrx[0] = kBackground;
+    for (std::size_t i = 1; i < lut.bgrx.size(); ++i) {
+        const float dbz = lut.min_dbz + static_cast<float>(i - 1) * lut.step_dbz;
+        std::uint32_t rgb = kBackground;
+        for (const auto& stop : kStandardStops) {
+            if (dbz >= stop.dbz) {
+                rgb = stop.rgb;
+            }
+        }
+        lut.bgrx[i] = rgb;
+    }
+    return lut;
+}
+
+std::uint8_t ReflectivityLut::index(float dbz) const {
+    if (!(dbz >= min_dbz)) {
+        return 0;
+    }
+    const float steps = std::min((dbz - min_dbz) * (1.0f / step_dbz), kMaxStep);
+    return static_cast<std::uint8_t>(static_cast<int>(steps) + 1);
+}
+
+void colour_gates(std::span<const std::uint32_t> gate_of_pixel, std::span<const float> gate_dbz,
+                  const ReflectivityLut& lut, unsigned char* bgr) {
+#if defined(__AVX2__)
+    colour_avx2(gate_of_pixel.data(), gate_of_pixel.size(), gate_dbz.data(), lut, bgr);
+#else
+    colour_scalar(gate_of_pixel.data(), gate_of_pixel.size(), gate_dbz.data(), lut, bgr);
+#endif
+}
+
+ReflectivityRenderer::ReflectivityRenderer(const CellGrid& layout, ReflectivityRenderOptions options,
+                                           ReflectivityLut lut)
+    : options_(options), lut_(lut), extent_(layout.extent()) {
+    if (options_.width == 0 || options_.height == 0) {
+        throw std::invalid_argument("Image dimensions must be positive");
+    }
+    if (extent_.area() > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())) {
+        throw std::invalid_argument("Grid too large for the reflectivity raster");
+    }
+    gate_of_pixel_.assign(options_.width * options_.height, kNoGate);
+    if (layout.empty()) {
+        return;
+    }
+
+    // Gate positions in an azimuthal equidistant projection about the radar, so pixel distance
+    // and direction from the centre are the true ground range and bearing.
+    const double radar_lat = options_.radar_latitude_deg * kPi / 180.0;
+    const double radar_lon = options_.radar_longitude_deg * kPi / 180.0;
+    auto offset = [&](const GeoCoordinate& point) {
+        const double lat = point.latitude_deg * kPi / 180.0;
+        const double dlon = point.longitude_deg * kPi / 180.0 - radar_lon;
+        const double half_dlat = (lat - radar_lat) / 2.0;
+        const double half_dlon = dlon / 2.0;
+        const double h = std::sin(half_dlat) * std::sin(half_dlat) +
+                         std::cos(radar_lat) * std::cos(lat) * std::sin(half_dlon) * std::sin(half_dlon);
+        const double range = 2.0 * kEarthRadiusKm * std::asin(std::sqrt(std::min(h, 1.0)));
+        const double y = std::sin(dlon) * std::cos(lat);
+        const double x = std::cos(radar_lat) * std::sin(lat) - std::sin(radar_lat) * std::cos(lat) * std::cos(dlon);
+        const double bearing = std::atan2(y, x);
+        return std::pair{range * std::sin(bearing), range * std::cos(bearing)};
+    };
+
+    // A ray points along the sum of its gate offsets, so gates that drift across bins at long
+    // range still give the ray one bearing.
+    const auto rows = layout.rows();
+    const auto columns = layout.columns();
+    std::vector<std::pair<double, double>> ray_direction(static_cast<std::size_t>(extent_.rows), {0.0, 0.0});
+    for (std::size_t i = 0; i < layout.size(); ++i) {
+        const auto [east, north] = offset(layout.center(i));
+        auto& direction = ray_direction[static_cast<std::size_t>(rows[i] - extent_.min_row)];
+        direction.first += east;
+        direction.second += north;
+    }
+    std::vector<std::pair<int, int>> ray_bins;  // azimuth bin, row
+    for (std::size_t r = 0; r < ray_direction.size(); ++r) {
+        const auto [east, north] = ray_direction[r];
+        if (east != 0.0 || north != 0.0) {
+            ray_bins.emplace_back(static_cast<int>(bearing_deg(east, north) * 10.0) % kAzimuthBins,
+                                  extent_.min_row + static_cast<int>(r));
+        }
+    }
+    if (ray_bins.empty()) {
+        return;
+    }
+
+    // A volume repeats its azimuths once per elevation, so the most common row step between
+    // rays of the same bearing is the sweep length. Only the lowest sweep with data is drawn:
+    // higher sweeps reach other ground ranges and would show through as seams.
+    std::sort(ray_bins.begin(), ray_bins.end());
+    std::unordered_map<int, std::size_t> step_count;
+    for (std::size_t k = 1; k < ray_bins.size(); ++k) {
+        if (ray_bins[k].first == ray_bins[k - 1].first) {
+            ++step_count[ray_bins[k].second - ray_bins[k - 1].second];
+        }
+    }
+    int sweep_rows = 0;
+    std::size_t best_count = 0;
+    for (const auto& [step, count] : step_count) {
+        if (count > best_count || (count == best_count && step < sweep_rows)) {
+            sweep_rows = step;
+            best_count = count;
+        }
+    }
+    const int sweep = sweep_rows > 0 ? extent_.min_row / sweep_rows : 0;
+
+    // Each ray of the sweep claims its 0.1 degree azimuth bin.
+    std::vector<int> bin_row(kAzimuthBins, -1);
+    for (const auto& [bin, row] : ray_bins) {
+        if ((sweep_rows == 0 || row / sweep_rows == sweep) && bin_row[bin] < 0) {
+            bin_row[bin] = row;
+        }
+    }
+    std::vector<int> occupied;
+    for (int bin = 0; bin < kAzimuthBins; ++bin) {
+        if (bin_row[bin] >= 0) {
+            occupied.push_back(bin);
+        }
+    }
+    if (occupied.empty()) {
+        return;
+    }
+    // Every bin shows its nearest ray within the typical spacing, so slightly uneven rays leave
+    // no seams while a missing ray is not stretched across a wide sector.
+    std::vector<int> gaps;
+    for (std::size_t k = 0; k < occupied.size(); ++k) {
+        const int next = k + 1 < occupied.size() ? occupied[k + 1] : occupied[0] + kAzimuthBins;
+        gaps.push_back(next - occupied[k]);
+    }
+    std::nth_element(gaps.begin(), gaps.begin() + static_cast<std::ptrdiff_t>(gaps.size() / 2), gaps.end());
+    const int reach = std::max(1, gaps[gaps.size() / 2]);
+    std::vector<int> ray_of_bin(kAzimuthBins, -1);
+    std::vector<int> ray_distance(kAzimuthBins, std::numeric_limits<int>::max());
+    for (int bin : occupied) {
+        for (int d = -reach; d <= reach; ++d) {
+            const int target = ((bin + d) % kAzimuthBins + kAzimuthBins) % kAzimuthBins;
+            if (std::abs(d) < ray_distance[target]) {
+                ray_distance[target] = std::abs(d);
+                ray_of_bin[target] = bin_row[bin];
+            }
+        }
+    }
+
+    // Gate ranges from the rays that are drawn; columns are range gates.
+    std::vector<char> drawn_row(static_cast<std::size_t>(extent_.rows), 0);
+    for (int bin : occupied) {
+        drawn_row[static_cast<std::size_t>(bin_row[bin] - extent_.min_row)] = 1;
+    }
+    std::vector<double> column_range(static_cast<std::size_t>(extent_.columns), -1.0);
+    double farthest = 0.0;
+    for (std::size_t i = 0; i < layout.size(); ++i) {
+        if (!drawn_row[static_cast<std::size_t>(rows[i] - extent_.min_row)]) {
+            continue;
+        }
+        const auto [east, north] = offset(layout.center(i));
+        const double range = std::hypot(east, north);
+        auto& slot = column_range[static_cast<std::size_t>(columns[i] - extent_.min_column)];
+        if (slot < 0.0) {
+            slot = range;
+        }
+        farthest = std::max(farthest, range);
+    }
+    std::vector<std::pair<double, int>> gates;
+    for (std::size_t c = 0; c < column_range.size(); ++c) {
+        if (column_range[c] >= 0.0) {
+            gates.emplace_back(column_range[c], extent_.min_column + static_cast<int>(c));
+        }
+    }
+    std::sort(gates.begin(), gates.end());
+    std::vector<double> spacings;
+    for (std::size_t k = 1; k < gates.size(); ++k) {
+        spacings.push_back(gates[k].first - gates[k - 1].first);
+    }
+    double gate_length = 1.0;
+    if (!spacings.empty()) {
+        std::nth_element(spacings.begin(), spacings.begin() + static_cast<std::ptrdiff_t>(spacings.size() / 2),
+                         spacings.end());
+        gate_length = std::max(spacings[spacings.size() / 2], 1e-3);
+    }
+    const double max_range = options_.max_range_km > 0.0 ? options_.max_range_km : farthest + gate_length / 2.0;
+    const double bin_km = gate_length / kRangeBinsPerGate;
+    const auto range_bins = static_cast<std::size_t>(std::ceil(max_range / bin_km)) + 1;
+    // Range bins likewise take the nearest gate within one gate length.
+    std::vector<int> column_of_bin(range_bins, -1);
+    std::vector<double> column_distance(range_bins, std::numeric_limits<double>::infinity());
+    for (const auto& [range, column] : gates) {
+        const double first = std::max(0.0, (range - gate_length) / bin_km);
+        const double last = std::min(static_cast<double>(range_bins), (range + gate_length) / bin_km);
+        for (auto bin = static_cast<std::size_t>(first); bin < static_cast<std::size_t>(last); ++bin) {
+            const double distance = std::abs((static_cast<double>(bin) + 0.5) * bin_km - range);
+            if (distance < column_distance[bin]) {
+                column_distance[bin] = distance;
+                column_of_bin[bin] = column;
+            }
+        }
+    }
+
+    // Square pixels; the shorter image side spans the full diameter.
+    const double km_per_pixel = 2.0 * max_range / static_cast<double>(std::min(options_.width, options_.height));
+    const double centre_x = static_cast<double>(options_.width) / 2.0;
+    const double centre_y = static_cast<double>(options_.height) / 2.0;
+    parallel_for(options_.height, options_.threads, 16, [&](std::size_t first_row, std::size_t last_row) {
+        for (std::size_t y = first_row; y < last_row; ++y) {
+            const double north = (centre_y - (static_cast<double>(y) + 0.5)) * km_per_pixel;
+            for (std::size_t x = 0; x < options_.width; ++x) {
+                const double east = ((static_cast<double>(x) + 0.5) - centre_x) * km_per_pixel;
+                const double range = std::hypot(east, north);
+                if (range >= max_range) {
+                    continue;
+                }
+                const int row = ray_of_bin[static_cast<int>(bearing_deg(east, north) * 10.0) % kAzimuthBins];
+                const int column = column_of_bin[static_cast<std::size_t>(range / bin_km)];
+                if (row < 0 || column < 0) {
+                    continue;
+                }
+                gate_of_pixel_[y * options_.width + x] = static_cast<std::uint32_t>(
+                    static_cast<std::size_t>(row - extent_.min_row) * static_cast<std::size_t>(extent_.columns) +
+                    static_cast<std::size_t>(column - extent_.min_column));
+            }
+        }
+    });
+}
+
+std::vector<unsigned char> ReflectivityRenderer::render(const CellGrid& grid) const {
+    // Scatter the scan into the gate raster the mapping points at.
+    std::vector<float> gate_dbz(extent_.area(), std::numeric_limits<float>::quiet_NaN());
+    const auto rows = grid.rows();
+    const auto columns = grid.columns();
+    const auto dbz = grid.reflectivity_dbz();
+    for (std::size_t i = 0; i < grid.size(); ++i) {
+        if (extent_.contains(rows[i], columns[i])) {
+            gate_dbz[static_cast<std::size_t>(rows[i] - extent_.min_row) * static_cast<std::size_t>(extent_.columns) +
+                     static_cast<std::size_t>(columns[i] - extent_.min_column)] = dbz[i];
+        }
+    }
+
+    std::vector<unsigned char> buffer(options_.width * options_.height * 3);
+    const std::size_t width = options_.width;
+    parallel_for(options_.height, options_.threads, 32, [&](std::size_t first_row, std::size_t last_row) {
+        colour_gates(std::span<const std::uint32_t>(gate_of_pixel_).subspan(first_row * width, (last_row - first_row) * width),
+                     gate_dbz, lut_, buffer.data() + 3 * first_row * width);
+    });
+    return buffer;
+}
+
+void ReflectivityRenderer::render(const CellGrid& grid, const std::string& output_path) const {
+    const auto buffer = render(grid);
+    ImageRenderer::write_image(buffer, ImageRenderOptions{
+        .width = options_.width,
+        .height = options_.height,
+        .threads = options_.threads,
+        .format = options_.format,
+        .palette = options_.palette,
+    }, output_path);
+}
+
+}  // namespace radar
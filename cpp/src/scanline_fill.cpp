@@ -0,0 +1,97 @@
+#include "radar/scanline_fill.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace radar {
+namespace {
+
+double clamp(double v, double lo, double hi) {
+    return std::max(lo, std::min(v, hi));
+}
+
+}  // namespace
+
+void ScanlineFiller::fill(const Polygon& polygon, const PixelBox& box, std::array<unsigned char, 3> bgr) {
+    if (polygon.vertices.size() < 3 || box.min_x > box.max_x || box.min_y > box.max_y) {
+        return;
+    }
+    edges_.clear();
+    add_ring(polygon.vertices, box);
+    for (const auto& hole : polygon.holes) {
+        add_ring(hole, box);
+    }
+    std::sort(edges_.begin(), edges_.end(),
+              [](const Edge& a, const Edge& b) { return a.first_row < b.first_row; });
+
+    active_.clear();
+    std::size_t next = 0;
+    for (int y = box.min_y; y <= box.max_y; ++y) {
+        while (next < edges_.size() && edges_[next].first_row <= y) {
+            active_.push_back(&edges_[next++]);
+        }
+        std::erase_if(active_, [y](const Edge* edge) { return edge->last_row < y; });
+        if (active_.empty()) {
+            continue;
+        }
+
+        const double lat = view_.y_to_lat(static_cast<std::size_t>(y));
+        crossings_.clear();
+        for (const Edge* edge : active_) {
+            if ((edge->yi > lat) != (edge->yj > lat)) {
+                crossings_.push_back((edge->xj - edge->xi) * (lat - edge->yi) / (edge->yj - edge->yi + 1e-12) +
+                                     edge->xi);
+            }
+        }
+        std::sort(crossings_.begin(), crossings_.end());
+
+        unsigned char* row = buffer_ + 3 * static_cast<std::size_t>(y) * view_.width();
+        for (std::size_t k = 0; k + 1 < crossings_.size(); k += 2) {
+            // Centres with crossings_[k] <= lon < crossings_[k + 1].
+            const int begin = first_x_at_or_after(crossings_[k], box);
+            const int end = first_x_at_or_after(crossings_[k + 1], box);
+            for (int x = begin; x < end; ++x) {
+                unsigned char* pixel = row + 3 * static_cast<std::size_t>(x);
+                pixel[0] = bgr[0];
+                pixel[1] = bgr[1];
+                pixel[2] = bgr[2];
+            }
+        }
+    }
+}
+
+void ScanlineFiller::add_ring(const std::vector<GeoCoordinate>& ring, const PixelBox& box) {
+    const std::size_t n = ring.size();
+    if (n < 3) {
+        return;
+    }
+    for (std::size_t i = 0, j = n - 1; i < n; j = i++) {
+        Edge edge{ring[i].longitude_deg, ring[i].latitude_deg, ring[j].longitude_deg, ring[j].latitude_deg, 0, 0};
+        if (edge.yi == edge.yj) {
+            continue;  // never crossed
+        }
+        // Rows grow southwards; pad by a pixel so rounding can only over-select.
+        const double top = std::floor(view_.lat_to_y(std::max(edge.yi, edge.yj))) - 1.0;
+        const double bottom = std::ceil(view_.lat_to_y(std::min(edge.yi, edge.yj))) + 1.0;
+        edge.first_row = static_cast<int>(clamp(top, box.min_y, box.max_y + 1.0));
+        edge.last_row = static_cast<int>(clamp(bottom, box.min_y - 1.0, box.max_y));
+        if (edge.first_row <= edge.last_row) {
+            edges_.push_back(edge);
+        }
+    }
+}
+
+// x_to_lon() is monotonic, so the estimate is corrected by stepping until the exact comparison
+// holds.
+int ScanlineFiller::first_x_at_or_after(double lon, const PixelBox& box) const {
+    int x = static_cast<int>(clamp(std::ceil(view_.lon_to_x(lon)), box.min_x, box.max_x + 1.0));
+    while (x > box.min_x && view_.x_to_lon(static_cast<std::size_t>(x - 1)) >= lon) {
+        --x;
+    }
+    while (x <= box.max_x && view_.x_to_lon(static_cast<std::size_t>(x)) < lon) {
+        ++x;
+    }
+    return x;
+}
+
+}  // namespace radar
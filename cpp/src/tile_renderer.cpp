@@ -0,0 +1,250 @@
+#include "radar/tile_renderer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#include "radar/image_renderer.h"
+#include "radar/parallel.h"
+#include "radar/png_writer.h"
+#include "radar/scanline_fill.h"
+
+namespace fs = std::filesystem;
+
+namespace radar {
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kMaxMercatorLatitude = 85.0511287798066;
+constexpr int kCoordinateBits = 26;  // enough for x and y at kMaxZoom
+
+// Tiles sort by zoom, then x, then y.
+std::uint64_t tile_key(int z, std::uint32_t x, std::uint32_t y) {
+    return (static_cast<std::uint64_t>(z) << (2 * kCoordinateBits)) |
+           (static_cast<std::uint64_t>(x) << kCoordinateBits) | y;
+}
+int key_zoom(std::uint64_t key) {
+    return static_cast<int>(key >> (2 * kCoordinateBits));
+}
+std::uint32_t key_x(std::uint64_t key) {
+    return static_cast<std::uint32_t>((key >> kCoordinateBits) & ((1u << kCoordinateBits) - 1));
+}
+std::uint32_t key_y(std::uint64_t key) {
+    return static_cast<std::uint32_t>(key & ((1u << kCoordinateBits) - 1));
+}
+
+// Web Mercator in world units: easting 0..1 from the antimeridian as longitude, northing 0..1
+// from the southern edge as latitude, so tiles are linear viewports over the projected rings.
+GeoCoordinate project(const GeoCoordinate& point) {
+    const double lat = std::clamp(point.latitude_deg, -kMaxMercatorLatitude, kMaxMercatorLatitude) * kPi / 180.0;
+    GeoCoordinate projected;
+    projected.longitude_deg = (point.longitude_deg + 180.0) / 360.0;
+    projected.latitude_deg = 0.5 + std::log(std::tan(kPi / 4.0 + lat / 2.0)) / (2.0 * kPi);
+    return projected;
+}
+
+std::vector<GeoCoordinate> project_ring(const std::vector<GeoCoordinate>& ring) {
+    std::vector<GeoCoordinate> projected;
+    projected.reserve(ring.size());
+    for (const auto& point : ring) {
+        projected.push_back(project(point));
+    }
+    return projected;
+}
+
+// FNV-1a over the encoding options and then the pixels, so a tile also counts as changed when
+// it would be encoded differently.
+std::uint64_t tile_hash(const std::vector<unsigned char>& pixels, const PngOptions& encoding) {
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](unsigned char byte) { hash = (hash ^ byte) * 0x100000001b3ull; };
+    mix(encoding.palette ? 1 : 0);
+    for (unsigned char byte : pixels) {
+        mix(byte);
+    }
+    return hash;
+}
+
+fs::path tile_path(const fs::path& root, std::uint64_t key) {
+    return root / std::to_string(key_zoom(key)) / std::to_string(key_x(key)) / (std::to_string(key_y(key)) + ".png");
+}
+
+std::unordered_map<std::uint64_t, std::uint64_t> load_manifest(const fs::path& path) {
+    std::unordered_map<std::uint64_t, std::uint64_t> hashes;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        int z = 0;
+        std::uint32_t x = 0;
+        std::uint32_t y = 0;
+        char slash = 0;
+        std::uint64_t hash = 0;
+        if (fields >> z >> slash >> x >> slash >> y >> std::hex >> hash) {
+            hashes[tile_key(z, x, y)] = hash;
+        }
+    }
+    return hashes;
+}
+
+}  // namespace
+
+TileRenderer::TileRenderer(fs::path output_dir, TileOptions options)
+    : output_dir_(std::move(output_dir)), options_(options) {
+    if (options_.min_zoom < 0 || options_.max_zoom > kMaxZoom || options_.min_zoom > options_.max_zoom) {
+        throw std::invalid_argument("Invalid tile zoom range");
+    }
+}
+
+TileStats TileRenderer::render(const std::vector<MergedContour>& contours) const {
+    struct Shape {
+        Polygon polygon;  // projected
+        GeoBounds bounds;
+        std::array<unsigned char, 3> bgr;
+    };
+    std::vector<Shape> shapes;
+    shapes.reserve(contours.size());
+    for (const auto& contour : contours) {
+        if (contour.geometry.vertices.size() < 3) {
+            continue;
+        }
+        Shape shape;
+        shape.polygon.vertices = project_ring(contour.geometry.vertices);
+        for (const auto& hole : contour.geometry.holes) {
+            shape.polygon.holes.push_back(project_ring(hole));
+        }
+        shape.bounds = GeoBounds{shape.polygon.vertices[0].latitude_deg, shape.polygon.vertices[0].latitude_deg,
+                                 shape.polygon.vertices[0].longitude_deg, shape.polygon.vertices[0].longitude_deg};
+        for (const auto& point : shape.polygon.vertices) {
+            shape.bounds.min_latitude_deg = std::min(shape.bounds.min_latitude_deg, point.latitude_deg);
+            shape.bounds.max_latitude_deg = std::max(shape.bounds.max_latitude_deg, point.latitude_deg);
+            shape.bounds.min_longitude_deg = std::min(shape.bounds.min_longitude_deg, point.longitude_deg);
+            shape.bounds.max_longitude_deg = std::max(shape.bounds.max_longitude_deg, point.longitude_deg);
+        }
+        const unsigned rgba = ImageRenderer::rgba_from_string(contour.phenomenon_type);
+        shape.bgr = {static_cast<unsigned char>((rgba >> 8) & 0xFF), static_cast<unsigned char>((rgba >> 16) & 0xFF),
+                     static_cast<unsigned char>((rgba >> 24) & 0xFF)};
+        shapes.push_back(std::move(shape));
+    }
+
+    // (tile, shape) pairs for every tile a shape's bounds reach; sorted, each tile's shapes stay
+    // in paint order.
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> hits;
+    for (int z = options_.min_zoom; z <= options_.max_zoom; ++z) {
+        const double n = std::ldexp(1.0, z);
+        const double last = n - 1.0;
+        for (std::uint32_t s = 0; s < shapes.size(); ++s) {
+            const auto& b = shapes[s].bounds;
+            const auto x0 = static_cast<std::uint32_t>(std::clamp(std::floor(b.min_longitude_deg * n), 0.0, last));
+            const auto x1 = static_cast<std::uint32_t>(std::clamp(std::floor(b.max_longitude_deg * n), 0.0, last));
+            const auto y0 = static_cast<std::uint32_t>(std::clamp(std::floor((1.0 - b.max_latitude_deg) * n), 0.0, last));
+            const auto y1 = static_cast<std::uint32_t>(std::clamp(std::floor((1.0 - b.min_latitude_deg) * n), 0.0, last));
+            for (std::uint32_t x = x0; x <= x1; ++x) {
+                for (std::uint32_t y = y0; y <= y1; ++y) {
+                    hits.emplace_back(tile_key(z, x, y), s);
+                }
+            }
+        }
+    }
+    std::sort(hits.begin(), hits.end());
+    std::vector<std::size_t> tile_begin;
+    for (std::size_t i = 0; i < hits.size(); ++i) {
+        if (i == 0 || hits[i].first != hits[i - 1].first) {
+            tile_begin.push_back(i);
+        }
+    }
+    tile_begin.push_back(hits.size());
+    const std::size_t tile_count = tile_begin.size() - 1;
+
+    const fs::path manifest_path = output_dir_ / "manifest.txt";
+    const auto previous = load_manifest(manifest_path);
+    const PngOptions encoding{.palette = options_.palette};
+
+    enum class Outcome : std::uint8_t { Blank, Unchanged, Written };
+    std::vector<Outcome> outcomes(tile_count, Outcome::Blank);
+    std::vector<std::uint64_t> hashes(tile_count, 0);
+    parallel_for(tile_count, options_.threads, 4, [&](std::size_t first_tile, std::size_t last_tile) {
+        std::vector<unsigned char> buffer(kTileSize * kTileSize * 3);
+        const PixelBox box{0, static_cast<int>(kTileSize) - 1, 0, static_cast<int>(kTileSize) - 1};
+        for (std::size_t t = first_tile; t < last_tile; ++t) {
+            const std::uint64_t key = hits[tile_begin[t]].first;
+            const double n = std::ldexp(1.0, key_zoom(key));
+            const Viewport view(1.0 - (key_y(key) + 1.0) / n, 1.0 - key_y(key) / n, key_x(key) / n,
+                                (key_x(key) + 1.0) / n, kTileSize, kTileSize);
+            std::fill(buffer.begin(), buffer.end(), static_cast<unsigned char>(255));
+            ScanlineFiller filler(view, buffer.data());
+            for (std::size_t h = tile_begin[t]; h < tile_begin[t + 1]; ++h) {
+                const auto& shape = shapes[hits[h].second];
+                filler.fill(shape.polygon, box, shape.bgr);
+            }
+            if (std::all_of(buffer.begin(), buffer.end(), [](unsigned char v) { return v == 255; })) {
+                continue;
+            }
+
+            hashes[t] = tile_hash(buffer, encoding);
+            const fs::path path = tile_path(output_dir_, key);
+            if (auto it = previous.find(key); it != previous.end() && it->second == hashes[t] && fs::exists(path)) {
+                outcomes[t] = Outcome::Unchanged;
+                continue;
+            }
+            const auto png = encode_png(buffer, kTileSize, kTileSize, encoding);
+            fs::create_directories(path.parent_path());
+            std::ofstream out(path, std::ios::binary);
+            out.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+            if (!out) {
+                throw std::runtime_error("Failed to write tile: " + path.string());
+            }
+            outcomes[t] = Outcome::Written;
+        }
+    });
+
+    TileStats stats;
+    std::unordered_map<std::uint64_t, std::uint64_t> current;
+    // A scan without contours writes no tiles but still needs the directory for its manifest.
+    fs::create_directories(output_dir_);
+    std::ofstream manifest(manifest_path.string() + ".tmp");
+    if (!manifest) {
+        throw std::runtime_error("Failed to open tile manifest for writing");
+    }
+    for (std::size_t t = 0; t < tile_count; ++t) {
+        if (outcomes[t] == Outcome::Blank) {
+            continue;
+        }
+        const std::uint64_t key = hits[tile_begin[t]].first;
+        current.emplace(key, hashes[t]);
+        ++stats.tiles;
+        ++(outcomes[t] == Outcome::Written ? stats.written : stats.unchanged);
+        manifest << key_zoom(key) << '/' << key_x(key) << '/' << key_y(key) << ' ' << std::hex << hashes[t] << std::dec
+                 << '\n';
+    }
+    manifest.close();
+    if (!manifest) {
+        throw std::runtime_error("Failed to write tile manifest");
+    }
+    fs::rename(manifest_path.string() + ".tmp", manifest_path);
+
+    for (const auto& [key, hash] : previous) {
+        if (!current.contains(key)) {
+            std::error_code ignored;
+            const fs::path path = tile_path(output_dir_, key);
+            if (fs::remove(path, ignored)) {
+                ++stats.removed;
+                // The <z>/<x> and <z> directories go once they are empty; remove() leaves
+                // directories that still hold tiles alone.
+                if (fs::remove(path.parent_path(), ignored)) {
+                    fs::remove(path.parent_path().parent_path(), ignored);
+                }
+            }
+        }
+    }
+    return stats;
+}
+
+}  // namespace radar
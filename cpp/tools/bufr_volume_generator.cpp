@@ -0,0 +1,355 @@
+// Writes a synthetic radar volume as BUFR, encoded with the widths, scales and references of a
+// descriptor table, plus a matching echo-tops matrix. Used to exercise the pipeline at scale.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "radar/config.h"
+
+using namespace radar;
+
+namespace {
+
+// Gate template, in section-3 order.
+const char* const kTemplate[] = {"0-001-019", "0-001-020", "0-002-063", "0-002-101", "0-002-102",
+                                 "0-008-021", "0-008-022", "0-008-023", "0-020-003"};
+constexpr std::size_t kFields = sizeof(kTemplate) / sizeof(kTemplate[0]);
+
+struct Options {
+    std::string output;
+    std::string tables_path = "descriptor_tables.json";
+    std::string echo_tops_path;
+    std::size_t azimuths = 360;
+    std::size_t gates = 250;
+    std::size_t elevations = 1;
+    std::size_t storms = 8;
+    unsigned seed = 1;
+    BufrLayout layout = BufrLayout::Compact;
+    bool compressed = false;
+};
+
+struct Storm {
+    double azimuth = 0.0;  // in rays
+    double gate = 0.0;
+    double radius = 0.0;  // in cells
+    double peak_dbz = 0.0;
+};
+
+struct Field {
+    std::string mnemonic;
+    std::uint32_t bits = 0;
+    double scale = 1.0;
+    double reference = 0.0;
+};
+
+class BitWriter {
+public:
+    void write(std::uint32_t value, std::uint32_t bits) {
+        for (std::uint32_t i = bits; i > 0; --i) {
+            current_ = static_cast<std::uint8_t>((current_ << 1) | ((value >> (i - 1)) & 1));
+            if (++filled_ == 8) {
+                bytes_.push_back(current_);
+                current_ = 0;
+                filled_ = 0;
+            }
+        }
+    }
+
+    std::vector<std::uint8_t> finish() {
+        if (filled_ != 0) {
+            bytes_.push_back(static_cast<std::uint8_t>(current_ << (8 - filled_)));
+            current_ = 0;
+            filled_ = 0;
+        }
+        return std::move(bytes_);
+    }
+
+private:
+    std::vector<std::uint8_t> bytes_;
+    std::uint8_t current_ = 0;
+    std::uint32_t filled_ = 0;
+};
+
+void put_uint(std::vector<std::uint8_t>& out, std::uint32_t value, std::size_t bytes) {
+    for (std::size_t i = bytes; i > 0; --i) {
+        out.push_back(static_cast<std::uint8_t>(value >> (8 * (i - 1))));
+    }
+}
+
+void put_section(std::vector<std::uint8_t>& out, const std::vector<std::uint8_t>& body) {
+    put_uint(out, static_cast<std::uint32_t>(body.size() + 3), 3);
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+std::uint32_t missing_value(std::uint32_t bits) {
+    return static_cast<std::uint32_t>((std::uint64_t{1} << bits) - 1);
+}
+
+std::uint32_t encode(const Field& field, double value) {
+    const double raw = std::round(value * field.scale) - field.reference;
+    if (raw < 0 || raw >= missing_value(field.bits)) {
+        throw std::runtime_error("Value " + std::to_string(value) + " does not fit " + field.mnemonic);
+    }
+    return static_cast<std::uint32_t>(raw);
+}
+
+std::vector<Field> load_fields(const std::string& tables_path) {
+    auto tables = ConfigLoader::load_tables(tables_path);
+    std::vector<Field> fields;
+    for (const char* key : kTemplate) {
+        auto it = tables.find(key);
+        if (it == tables.end()) {
+            throw std::runtime_error(std::string("Descriptor not found in tables: ") + key);
+        }
+        const auto& def = it->second;
+        if (def.bits <= 0 || def.bits > 32) {
+            throw std::runtime_error("Unsupported bit width for descriptor " + def.mnemonic);
+        }
+        fields.push_back(Field{def.mnemonic, static_cast<std::uint32_t>(def.bits), std::pow(10.0, def.scale),
+                               static_cast<double>(def.reference)});
+    }
+    return fields;
+}
+
+std::vector<std::uint8_t> section3_descriptors() {
+    std::vector<std::uint8_t> out;
+    for (const char* key : kTemplate) {
+        int f = 0;
+        int x = 0;
+        int y = 0;
+        std::sscanf(key, "%d-%d-%d", &f, &x, &y);
+        out.push_back(static_cast<std::uint8_t>((f << 6) | x));
+        out.push_back(static_cast<std::uint8_t>(y));
+    }
+    return out;
+}
+
+// Raw values of one subset per row.
+using Rows = std::vector<std::array<std::uint32_t, kFields>>;
+
+void write_message(std::ofstream& stream, const Options& options, const std::vector<Field>& fields, const Rows& rows) {
+    BitWriter data;
+    if (options.compressed) {
+        // Per field: minimum, 6-bit increment width, then one increment per subset.
+        for (std::size_t k = 0; k < kFields; ++k) {
+            std::uint32_t low = rows.front()[k];
+            std::uint32_t high = low;
+            for (const auto& row : rows) {
+                low = std::min(low, row[k]);
+                high = std::max(high, row[k]);
+            }
+            std::uint32_t width = 0;
+            while (width < 32 && missing_value(width) <= high - low) {
+                ++width;
+            }
+            data.write(low, fields[k].bits);
+            data.write(width, 6);
+            if (width != 0) {
+                for (const auto& row : rows) {
+                    data.write(row[k] - low, width);
+                }
+            }
+        }
+    } else {
+        for (const auto& row : rows) {
+            for (std::size_t k = 0; k < kFields; ++k) {
+                data.write(row[k], fields[k].bits);
+            }
+        }
+    }
+
+    std::vector<std::uint8_t> body;
+    std::vector<std::uint8_t> section3;
+    std::vector<std::uint8_t> section4;
+    const auto descriptors = section3_descriptors();
+    if (options.layout == BufrLayout::Wmo) {
+        put_section(body, std::vector<std::uint8_t>(19, 0));  // edition 4 section 1, no section 2
+        section3.push_back(0);
+        put_uint(section3, static_cast<std::uint32_t>(rows.size()), 2);
+        section3.push_back(options.compressed ? 0xC0 : 0x80);
+        section4.push_back(0);
+    } else {
+        put_section(body, std::vector<std::uint8_t>(15, 0));
+        put_section(body, {0});  // the compact layout expects a section 2
+        section3.push_back(0x80);
+    }
+    section3.insert(section3.end(), descriptors.begin(), descriptors.end());
+    auto bits = data.finish();
+    section4.insert(section4.end(), bits.begin(), bits.end());
+    put_section(body, section3);
+    put_section(body, section4);
+
+    std::vector<std::uint8_t> message{'B', 'U', 'F', 'R'};
+    put_uint(message, static_cast<std::uint32_t>(8 + body.size() + 4), 3);
+    message.push_back(4);
+    message.insert(message.end(), body.begin(), body.end());
+    message.insert(message.end(), {'7', '7', '7', '7'});
+    stream.write(reinterpret_cast<const char*>(message.data()), static_cast<std::streamsize>(message.size()));
+}
+
+std::size_t parse_count(const std::string& value) {
+    char* end = nullptr;
+    auto parsed = std::strtoull(value.c_str(), &end, 10);
+    if (end == value.c_str() || *end != '\0') {
+        throw std::runtime_error("Invalid number: " + value);
+    }
+    return static_cast<std::size_t>(parsed);
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "--tables") {
+            options.tables_path = next();
+        } else if (arg == "--echo-tops") {
+            options.echo_tops_path = next();
+        } else if (arg == "--azimuths") {
+            options.azimuths = parse_count(next());
+        } else if (arg == "--gates") {
+            options.gates = parse_count(next());
+        } else if (arg == "--elevations") {
+            options.elevations = parse_count(next());
+        } else if (arg == "--storms") {
+            options.storms = parse_count(next());
+        } else if (arg == "--seed") {
+            options.seed = static_cast<unsigned>(parse_count(next()));
+        } else if (arg == "--layout") {
+            auto layout = next();
+            if (layout != "compact" && layout != "wmo") {
+                throw std::runtime_error("Unknown layout: " + layout);
+            }
+            options.layout = layout == "wmo" ? BufrLayout::Wmo : BufrLayout::Compact;
+        } else if (arg == "--compressed") {
+            options.compressed = true;
+        } else if (options.output.empty() && arg.rfind("--", 0) != 0) {
+            options.output = arg;
+        } else {
+            throw std::runtime_error("Unknown argument: " + arg);
+        }
+    }
+    if (options.output.empty()) {
+        throw std::runtime_error("No output file given");
+    }
+    if (options.azimuths == 0 || options.gates == 0 || options.elevations == 0) {
+        throw std::runtime_error("Azimuths, gates and elevations must be positive");
+    }
+    if (options.compressed && options.layout != BufrLayout::Wmo) {
+        throw std::runtime_error("Compressed data requires --layout wmo");
+    }
+    return options;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        auto options = parse_options(argc, argv);
+        auto fields = load_fields(options.tables_path);
+
+        std::mt19937 rng(options.seed);
+        auto uniform = [&](double low, double high) { return std::uniform_real_distribution<double>(low, high)(rng); };
+        const double spread = std::max(1.0, static_cast<double>(options.gates) / 60.0);
+        std::vector<Storm> storms;
+        for (std::size_t i = 0; i < options.storms; ++i) {
+            storms.push_back(Storm{uniform(0.0, static_cast<double>(options.azimuths)),
+                                   uniform(std::min(5.0, options.gates - 1.0), static_cast<double>(options.gates)),
+                                   uniform(2.0, 8.0) * spread, uniform(45.0, 65.0)});
+        }
+
+        std::ofstream stream(options.output, std::ios::binary);
+        if (!stream.is_open()) {
+            throw std::runtime_error("Cannot open output file: " + options.output);
+        }
+        std::ofstream echo_tops;
+        if (!options.echo_tops_path.empty()) {
+            echo_tops.open(options.echo_tops_path);
+            if (!echo_tops.is_open()) {
+                throw std::runtime_error("Cannot open echo tops output: " + options.echo_tops_path);
+            }
+        }
+
+        // Rows enumerate (elevation, azimuth) pairs and columns are gates, as the grid expects.
+        // Compact output holds one gate per message; WMO output one ray per message.
+        Rows rows;
+        std::size_t messages = 0;
+        for (std::size_t elevation = 0; elevation < options.elevations; ++elevation) {
+            const double elevation_deg = 0.5 + static_cast<double>(elevation);
+            for (std::size_t azimuth = 0; azimuth < options.azimuths; ++azimuth) {
+                const double azimuth_deg = 360.0 * static_cast<double>(azimuth) / static_cast<double>(options.azimuths);
+                const std::size_t row = elevation * options.azimuths + azimuth;
+                for (std::size_t gate = 0; gate < options.gates; ++gate) {
+                    double dbz = uniform(-10.0, -5.0);
+                    for (const auto& storm : storms) {
+                        double da = std::abs(static_cast<double>(azimuth) - storm.azimuth);
+                        da = std::min(da, static_cast<double>(options.azimuths) - da);
+                        const double dg = static_cast<double>(gate) - storm.gate;
+                        const double peak = storm.peak_dbz - 4.0 * static_cast<double>(elevation);
+                        dbz = std::max(dbz, peak * std::exp(-(da * da + dg * dg) / (2.0 * storm.radius * storm.radius)));
+                    }
+                    const double values[kFields] = {
+                        azimuth_deg,
+                        elevation_deg,
+                        static_cast<double>(gate + 1),
+                        static_cast<double>(row),
+                        static_cast<double>(gate),
+                        dbz,
+                        uniform(-20.0, 20.0),
+                        uniform(0.0, 5.0),
+                        dbz >= 55.0 ? 2.0 : 1.0,  // hail over rain
+                    };
+                    std::array<std::uint32_t, kFields> raw{};
+                    for (std::size_t k = 0; k < kFields; ++k) {
+                        raw[k] = encode(fields[k], values[k]);
+                    }
+                    rows.push_back(raw);
+                    if (options.layout == BufrLayout::Compact) {
+                        write_message(stream, options, fields, rows);
+                        rows.clear();
+                        ++messages;
+                    }
+                    if (echo_tops.is_open()) {
+                        echo_tops << (gate != 0 ? "," : "") << std::max(0.0, std::round(dbz * 2.5) / 10.0);
+                    }
+                }
+                if (!rows.empty()) {
+                    write_message(stream, options, fields, rows);
+                    rows.clear();
+                    ++messages;
+                }
+                if (echo_tops.is_open()) {
+                    echo_tops << '\n';
+                }
+            }
+        }
+        if (!stream) {
+            throw std::runtime_error("Failed to write output file: " + options.output);
+        }
+        std::cout << "Wrote " << messages << " BUFR messages ("
+                  << options.elevations * options.azimuths * options.gates << " gates) to " << options.output
+                  << std::endl;
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << '\n'
+                  << "Usage: radar_bufr_generator <output.bufr> [--tables path] [--echo-tops path] [--azimuths n]\n"
+                  << "       [--gates n] [--elevations n] [--storms n] [--seed n] [--layout compact|wmo] "
+                     "[--compressed]\n";
+        return 1;
+    }
+    return 0;
+}